@@ -0,0 +1,94 @@
+#ifndef ASSETSTREAMER_H
+#define ASSETSTREAMER_H
+
+#include <glad/glad.h>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <glm/glm.hpp>
+#include "CollisionShape.h"
+#include "MeshPool.h"
+#include "Prism.h"
+#include "RingBuffer.h"
+#include "SceneGraph.h"
+
+// Where a streamed mesh is drawn and with which material. The transform is
+// relative to node, or the world without one.
+struct StreamedPlacement {
+	uint32_t material;
+	glm::mat4 transform;
+	SceneNode node;
+};
+
+// A decoded mesh waiting for upload, drawn once per placement. group ties
+// meshes to whatever requested them, so they can be cancelled together.
+// The local bounds are filled in by submit(), which also packs the
+// positions of VERTEX_FORMAT_UNORM16X3 meshes; the prism keeps the floats.
+// The collision shape, when given, is built by whoever submits the mesh on
+// the loader thread and shared by all of its placements.
+struct StreamedMesh {
+	StreamedMesh(Prism prism, std::vector<StreamedPlacement> placements, uint32_t group = 0,
+				 VertexFormat format = VERTEX_FORMAT_FLOAT3);
+
+	Prism prism;
+	std::vector<StreamedPlacement> placements;
+	uint32_t group;
+	VertexFormat format;
+	glm::vec3 bounds_min;
+	glm::vec3 bounds_max;
+	std::vector<uint32_t> quantized;
+	float position_scale[3];
+	float position_offset[3];
+	std::shared_ptr<CollisionShape> collision;
+};
+
+// Loads assets in the background and uploads them to the mesh pool a little
+// every frame. Requests run in order on the streamer's own thread, which may
+// decode in parallel on the job system, and submit() each mesh as soon as it
+// is decoded. update() copies at most frame_budget bytes per frame through a
+// persistently mapped staging ring into reserved pool ranges, so a large mesh
+// is spread over several frames, and hands each mesh over once it is whole.
+class AssetStreamer {
+public:
+	AssetStreamer(MeshPool& pool, GLsizeiptr frame_budget);
+	void initialize();
+	void request(std::function<void()> load);
+	void submit(StreamedMesh mesh);
+	void cancel(uint32_t group);
+	void update(const std::function<void(MeshHandle, StreamedMesh&)>& ready);
+	int getPendingCount();
+	GLsizeiptr getUploadedBytes();
+	void destroy();
+
+private:
+	struct Upload {
+		StreamedMesh mesh;
+		MeshHandle handle;
+		bool reserved;
+		GLsizeiptr vertex_bytes;
+		GLsizeiptr index_bytes;
+	};
+
+	bool stage(Upload& upload, bool indices);
+	void loaderLoop();
+
+	MeshPool& pool_;
+	RingBuffer staging_;
+	GLsizeiptr frame_budget_;
+	GLsizeiptr uploaded_bytes_;
+	std::deque<Upload> uploads_;
+	std::mutex mutex_;
+	std::condition_variable wake_;
+	std::deque<std::function<void()>> requests_;
+	std::vector<StreamedMesh> submitted_;
+	int loading_;
+	bool running_;
+	std::thread loader_;
+};
+
+#endif
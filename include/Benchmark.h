@@ -0,0 +1,10 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+// Run with ./d3 --benchmark [model]. Results are printed to stdout. These
+// need no GL context; main() runs the GL benchmarks once a window is open.
+// Import throughput is measured on the given OBJ or PLY file, or on
+// generated ones when there is none.
+void runBenchmarks(const char* import_path);
+
+#endif
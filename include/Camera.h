@@ -0,0 +1,74 @@
+#ifndef CAMERA_H
+#define CAMERA_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// Frustum plane order in getFrustumPlanes()
+enum FrustumPlane {
+	FRUSTUM_LEFT,
+	FRUSTUM_RIGHT,
+	FRUSTUM_BOTTOM,
+	FRUSTUM_TOP,
+	FRUSTUM_NEAR,
+	FRUSTUM_FAR,
+	FRUSTUM_PLANE_COUNT
+};
+
+// First person camera. Yaw and pitch are in degrees, a yaw of 0 looks down
+// +x and 90 down +z, pitch is clamped to straight up and down. Orientation
+// is kept as a quaternion whose rotated axes are the basis vectors.
+//
+// Changes only mark the camera dirty. The first getter after a change
+// rebuilds the basis, view, view-projection and frustum planes once, so any
+// number of consumers per frame share one derivation and a still camera
+// costs nothing.
+class Camera {
+public:
+	Camera(const glm::vec3& position, float yaw, float pitch, float fov, float aspect, float near_plane,
+		   float far_plane);
+	void rotate(float yaw, float pitch);
+	void move(const glm::vec3& offset);
+	void setPosition(const glm::vec3& position);
+	void setProjection(float fov, float aspect, float near_plane, float far_plane);
+
+	const glm::vec3& getPosition();
+	const glm::quat& getOrientation();
+	const glm::vec3& getFront();
+	const glm::vec3& getRight();
+	const glm::vec3& getUp();
+	const glm::vec3& getHeading();
+	const glm::mat4& getView();
+	const glm::mat4& getProjection();
+	const glm::mat4& getViewProjection();
+
+	// Planes as normal and distance, normals pointing into the frustum
+	const glm::vec4* getFrustumPlanes();
+	bool isBoxVisible(const glm::vec3& min, const glm::vec3& max);
+
+private:
+	void update();
+
+	glm::vec3 position_;
+	float yaw_;
+	float pitch_;
+	float fov_;
+	float aspect_;
+	float near_;
+	float far_;
+	bool orientation_dirty_;
+	bool view_dirty_;
+	bool projection_dirty_;
+
+	glm::quat orientation_;
+	glm::vec3 front_;
+	glm::vec3 right_;
+	glm::vec3 up_;
+	glm::vec3 heading_;
+	glm::mat4 view_;
+	glm::mat4 projection_;
+	glm::mat4 view_projection_;
+	glm::vec4 planes_[FRUSTUM_PLANE_COUNT];
+};
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef COLLISIONSHAPE_H
+#define COLLISIONSHAPE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Prism.h"
+
+// Triangles of one mesh in the mesh's own space, bucketed in a uniform grid
+// over its bounds. Built once per mesh off the render thread and never
+// changed afterwards, so every placement of the mesh shares one copy and
+// queries need no lock. Triangles are read through the mesh's prism, which
+// shares the file mapping or owned storage; the shape only owns its grid
+// and the ids of the triangles it kept.
+//
+// Each cell's triangle ids are a range of one packed array. The cell size is
+// grown for meshes whose bounds would need more cells than they have
+// triangles, and a triangle that would cover more than MAX_TRIANGLE_CELLS
+// cells goes into an overflow list returned by every query instead.
+class CollisionShape {
+public:
+	CollisionShape(Prism& prism, float cell_size);
+
+	// Appends triangles that may touch the box, some possibly more than once
+	void query(const glm::vec3& min, const glm::vec3& max, std::vector<uint32_t>& triangles);
+	void getTriangle(uint32_t triangle, glm::vec3 corners[3]);
+	const glm::vec3& getBoundsMin();
+	const glm::vec3& getBoundsMax();
+	int getTriangleCount();
+	size_t getByteSize();
+
+	static const int MAX_TRIANGLE_CELLS = 64;
+
+private:
+	void getCell(const glm::vec3& position, int cell[3]);
+	bool getCellRange(uint32_t triangle, int cell_min[3], int cell_max[3]);
+	int getCellIndex(int x, int y, int z);
+
+	Prism prism_;
+	// First index of each kept triangle
+	std::vector<uint32_t> triangles_;
+	glm::vec3 bounds_min_;
+	glm::vec3 bounds_max_;
+	float cell_size_;
+	int dimensions_[3];
+	std::vector<uint32_t> cell_starts_;
+	std::vector<uint32_t> cell_triangles_;
+	std::vector<uint32_t> overflow_;
+};
+
+#endif
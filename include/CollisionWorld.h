@@ -0,0 +1,81 @@
+#ifndef COLLISIONWORLD_H
+#define COLLISIONWORLD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+#include "CollisionShape.h"
+
+// Placed collision shapes for moving a sphere through the scene. Each
+// placement keeps only its shape, transform and world box; the triangles
+// stay in the shape's own space, shared by every placement of a mesh.
+// Placements are bucketed in a coarse uniform grid hashed by cell, so a
+// sweep visits the placements near its bounding box, looks up triangles in
+// each shape's grid with the box taken into the shape's space and tests
+// them in world space: the cost follows the geometry near the sphere, not
+// the size of the scene.
+//
+// Adding a placement touches at most MAX_INSTANCE_CELLS cells, larger ones
+// are kept in an overflow list visited by every sweep. Placements are added
+// per owner and removed by owner; moving an owner means removing and adding
+// it again.
+class CollisionWorld {
+public:
+	CollisionWorld(float cell_size);
+	void add(uint64_t owner, std::shared_ptr<CollisionShape> shape, const glm::mat4& transform);
+	void remove(uint64_t owner);
+
+	// Earliest contact of a sphere moving from position by motion, as a
+	// fraction of the motion, and the contact normal. Contacts the sphere
+	// already touches only count while it moves further in.
+	bool sweepSphere(const glm::vec3& position, float radius, const glm::vec3& motion, float& time,
+					 glm::vec3& normal);
+
+	// Moves the sphere as far as it can, sliding along what it touches
+	glm::vec3 moveSphere(const glm::vec3& position, float radius, const glm::vec3& motion);
+
+	int getTriangleCount();
+	size_t getTestedCount();
+
+	static const int MAX_SLIDES = 4;
+	static const int MAX_INSTANCE_CELLS = 64;
+
+private:
+	struct Instance {
+		std::shared_ptr<CollisionShape> shape;
+		glm::mat4 transform;
+		glm::mat4 inverse;
+		glm::vec3 bounds_min;
+		glm::vec3 bounds_max;
+		int cell_min[3];
+		int cell_max[3];
+		bool overflow;
+	};
+
+	void getCell(const glm::vec3& position, int cell[3]);
+	static uint64_t getCellKey(int x, int y, int z);
+	static void transformBounds(const glm::mat4& transform, const glm::vec3& min, const glm::vec3& max,
+								glm::vec3& out_min, glm::vec3& out_max);
+	void sweepInstance(Instance& instance, const glm::vec3& position, float radius, const glm::vec3& motion,
+					   const glm::vec3& sweep_min, const glm::vec3& sweep_max, float& best, glm::vec3& contact,
+					   bool& hit);
+
+	float cell_size_;
+	std::vector<Instance> instances_;
+	std::vector<uint32_t> free_instances_;
+	std::unordered_map<uint64_t, std::vector<uint32_t>> cells_;
+	std::vector<uint32_t> overflow_;
+	std::unordered_map<uint64_t, uint32_t> owners_;
+	int triangle_count_;
+
+	// Marks placements already visited by the current sweep
+	std::vector<uint32_t> stamps_;
+	uint32_t stamp_;
+	std::vector<uint32_t> candidates_;
+	size_t tested_;
+};
+
+#endif
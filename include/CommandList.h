@@ -0,0 +1,87 @@
+#ifndef COMMANDLIST_H
+#define COMMANDLIST_H
+
+#include <cstdint>
+#include <vector>
+
+enum CommandType : uint32_t {
+	COMMAND_BIND_PROGRAM,
+	COMMAND_BIND_VERTEX_ARRAY,
+	COMMAND_SET_MATRIX,
+	COMMAND_DRAW_INDEXED,
+	COMMAND_BIND_STORAGE,
+	COMMAND_MULTI_DRAW_INDIRECT,
+	COMMAND_SET_VECTOR
+};
+
+struct CommandHeader {
+	CommandType type;
+	uint32_t size;
+};
+
+struct BindProgramCommand {
+	uint32_t program;
+};
+
+struct BindVertexArrayCommand {
+	uint32_t vertex_array;
+};
+
+struct SetMatrixCommand {
+	int32_t location;
+	float matrix[16];
+};
+
+struct SetVectorCommand {
+	int32_t location;
+	float vector[3];
+};
+
+struct DrawIndexedCommand {
+	int32_t index_count;
+	uint32_t first_index;
+	int32_t base_vertex;
+};
+
+// Size 0 binds the whole buffer
+struct BindStorageCommand {
+	uint32_t binding;
+	uint32_t buffer;
+	int64_t offset;
+	int64_t size;
+};
+
+// draw_count packed indirect commands starting at offset in buffer, of the
+// elements layout when indexed and the arrays layout otherwise. The triangle
+// count is only for statistics.
+struct MultiDrawIndirectCommand {
+	uint32_t buffer;
+	uint32_t indexed;
+	int64_t offset;
+	int32_t draw_count;
+	int32_t triangle_count;
+};
+
+// Packed stream of render commands. Recording touches no API state, so any
+// thread can fill its own list; the render thread replays the lists in
+// order. Storage is kept between frames.
+class CommandList {
+public:
+	void clear();
+	void bindProgram(uint32_t program);
+	void bindVertexArray(uint32_t vertex_array);
+	void setMatrix(int32_t location, const float* matrix);
+	void setVector(int32_t location, const float* vector);
+	void drawIndexed(int32_t index_count, uint32_t first_index, int32_t base_vertex);
+	void bindStorage(uint32_t binding, uint32_t buffer, int64_t offset = 0, int64_t size = 0);
+	void multiDrawIndirect(uint32_t buffer, bool indexed, int64_t offset, int32_t draw_count, int32_t triangle_count);
+	const uint8_t* begin() const;
+	const uint8_t* end() const;
+
+private:
+	template<class T> void write(CommandType type, const T& payload);
+
+	std::vector<uint8_t> data_;
+};
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef COMMANDREPLAYER_H
+#define COMMANDREPLAYER_H
+
+#include <glad/glad.h>
+#include <map>
+#include "CommandList.h"
+
+// Executes command lists with OpenGL on the render thread. Binds go through
+// gl_state, which drops those matching the current binding, and matrix
+// uploads identical to the value already set on the program are skipped, so
+// lists recorded independently do not pay for repeating each other's state.
+class CommandReplayer {
+public:
+	CommandReplayer();
+	void beginFrame();
+	void replay(const CommandList& list);
+	int getDrawCount();
+	int getTriangleCount();
+	int getSkippedCount();
+
+private:
+	struct Matrix {
+		float values[16];
+	};
+
+	GLuint program_;
+	std::map<GLint, Matrix> matrices_;
+	int draw_count_;
+	int triangle_count_;
+	int skipped_count_;
+};
+
+#endif
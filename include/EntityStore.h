@@ -0,0 +1,83 @@
+#ifndef ENTITYSTORE_H
+#define ENTITYSTORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include "MeshPool.h"
+#include "Prism.h"
+#include "SceneGraph.h"
+
+// Slot index in the low 32 bits, the slot's generation in the high 32, so a
+// handle to a destroyed entity is recognised even after its slot is reused.
+// A slot would have to be reused four billion times for a stale handle to
+// match again.
+typedef uint64_t EntityHandle;
+
+#define INVALID_ENTITY 0xFFFFFFFFFFFFFFFFull
+#define ENTITY_INDEX_BITS 32
+#define ENTITY_MAX_COUNT (1u << 24)
+
+// Drawable objects stored as a structure of arrays. Every component is its
+// own densely packed array indexed 0..getCount()-1, and removal moves the
+// last entity into the hole, so all loops are linear sweeps over memory that
+// is fully in use. Position, rotation and scale are split into one array per
+// scalar. updateTransforms() composes a range of them into world matrices in
+// one batch with composeTransforms(), then applies parents and derives world
+// bounds in a second pass over the same range.
+//
+// An entity attached to a scene graph node is placed relative to that node:
+// its world matrix is the node's world transform times its own. Unattached
+// entities skip the multiply.
+//
+// Dense indices change when entities are destroyed; handles stay valid.
+class EntityStore {
+public:
+	EntityStore();
+	EntityHandle create(MeshHandle mesh, const Prism& prism, uint32_t material, uint32_t group);
+	void destroy(EntityHandle entity);
+	bool isAlive(EntityHandle entity);
+	int getIndex(EntityHandle entity);
+	EntityHandle getHandle(int index);
+	int getCount();
+
+	void setTransform(EntityHandle entity, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale);
+	void setTransform(EntityHandle entity, const glm::mat4& transform);
+	void setBounds(EntityHandle entity, const glm::vec3& local_min, const glm::vec3& local_max);
+	void setParent(EntityHandle entity, SceneNode node);
+	void updateTransforms(SceneGraph& graph, int begin, int end);
+
+	const glm::mat4* getWorldMatrices();
+	const glm::vec3* getWorldBoundsMin();
+	const glm::vec3* getWorldBoundsMax();
+	const MeshHandle* getMeshes();
+	const uint32_t* getMaterials();
+	const uint32_t* getGroups();
+	Prism& getPrism(int index);
+
+private:
+	// Hot, read by every transform update
+	std::vector<float> position_x_, position_y_, position_z_;
+	std::vector<float> rotation_x_, rotation_y_, rotation_z_, rotation_w_;
+	std::vector<float> scale_x_, scale_y_, scale_z_;
+	std::vector<glm::vec3> local_min_, local_max_;
+	std::vector<SceneNode> parents_;
+
+	// Written by the update, read by culling, sorting and drawing
+	std::vector<glm::mat4> world_;
+	std::vector<glm::vec3> world_min_, world_max_;
+	std::vector<MeshHandle> meshes_;
+	std::vector<uint32_t> materials_;
+
+	// Cold, only touched on creation, removal and by queries
+	std::vector<uint32_t> groups_;
+	std::vector<Prism> prisms_;
+	std::vector<EntityHandle> dense_to_handle_;
+	std::vector<uint32_t> slot_to_dense_;
+	std::vector<uint32_t> generations_;
+	std::vector<uint32_t> free_slots_;
+};
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef FRAMEPIPELINE_H
+#define FRAMEPIPELINE_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include <glm/glm.hpp>
+#include "MeshPool.h"
+
+// Everything the render thread needs to submit one frame. Written only by
+// the simulation thread and immutable once published.
+struct FrameSnapshot {
+	uint64_t frame;
+	glm::vec3 camera_position;
+	glm::vec3 camera_front;
+	glm::mat4 view;
+	glm::mat4 projection;
+	std::vector<MeshHandle> meshes;
+	std::vector<uint32_t> materials;
+	std::vector<glm::vec4> material_colors;
+	std::vector<glm::mat4> models;
+};
+
+// Hands frame snapshots from the simulation thread to the render thread.
+// The simulation may run up to latency_budget frames ahead of the frame
+// being rendered; with a budget of one it fills frame N+1 while frame N is
+// submitted. Snapshot storage is recycled, so steady state never allocates.
+class FramePipeline {
+public:
+	FramePipeline(int latency_budget);
+	FrameSnapshot* beginWrite();
+	void publish();
+	const FrameSnapshot* acquire();
+	void release();
+	void stop();
+
+private:
+	std::vector<FrameSnapshot> slots_;
+	int write_;
+	int read_;
+	int filled_;
+	uint64_t frame_;
+	bool stopped_;
+	std::mutex mutex_;
+	std::condition_variable changed_;
+};
+
+#endif
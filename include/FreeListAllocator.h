@@ -0,0 +1,27 @@
+#ifndef FREELISTALLOCATOR_H
+#define FREELISTALLOCATOR_H
+
+#include <map>
+
+// First-fit range allocator over [0, capacity). Free blocks are kept sorted
+// by offset and coalesced with their neighbours when released. Aligned
+// allocations leave the padding in front of them free.
+class FreeListAllocator {
+public:
+	FreeListAllocator(long capacity);
+	long allocate(long size, long alignment = 1);
+	void release(long offset, long size);
+	long findHole(long size, long below, long alignment = 1);
+	bool isCompact();
+	long getCapacity();
+	long getFreeSize();
+
+	static const long INVALID_OFFSET = -1;
+
+private:
+	long capacity_;
+	long free_size_;
+	std::map<long, long> free_blocks_;
+};
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef GLDEBUG_H
+#define GLDEBUG_H
+
+// GL error reporting through GL_KHR_debug instead of polling glGetError().
+// Release builds listen for high severity messages only, delivered
+// asynchronously by the driver. Debug builds (make debug) request a debug
+// context and receive messages synchronously, tagged with the location of
+// the last GL_DEBUG_MARK() on the render thread.
+
+void requestDebugContext();
+void initializeDebugOutput();
+
+#ifdef D3_DEBUG
+void markDebugLocation(const char* file, int line, const char* function);
+#define GL_DEBUG_MARK() markDebugLocation(__FILE__, __LINE__, __func__)
+#else
+#define GL_DEBUG_MARK() ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef GLSTATECACHE_H
+#define GLSTATECACHE_H
+
+#include <glad/glad.h>
+
+// Shadows the GL state the renderer touches and drops calls that would not
+// change it. Render thread only; all binds of the tracked state must go
+// through gl_state, or invalidate() must be called afterwards. Deleted
+// buffers and vertex arrays must be forgotten, GL may hand their names out
+// again and a bind of the new object would otherwise be dropped.
+class GLStateCache {
+public:
+	GLStateCache();
+	void useProgram(GLuint program);
+	void bindVertexArray(GLuint vertex_array);
+	void bindBuffer(GLenum target, GLuint buffer);
+	void bindBufferBase(GLenum target, GLuint index, GLuint buffer);
+	void bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+	void polygonMode(GLenum mode);
+	void setBlend(bool enabled);
+	void blendFunc(GLenum source, GLenum destination);
+	void setDepthTest(bool enabled);
+	void depthMask(bool enabled);
+	void clearColor(float r, float g, float b, float a);
+	void forgetBuffer(GLuint buffer);
+	void forgetVertexArray(GLuint vertex_array);
+	void invalidate();
+	void resetCounters();
+	int getIssuedCount();
+	int getSuppressedCount();
+	int getProgramBindCount();
+	int getVertexArrayBindCount();
+
+private:
+	static const int BUFFER_TARGET_COUNT = 8;
+	static const int STORAGE_BINDING_COUNT = 8;
+	static const GLuint UNKNOWN = 0xFFFFFFFF;
+
+	// Size 0 stands for the whole buffer
+	struct IndexedBinding {
+		GLuint buffer;
+		GLintptr offset;
+		GLsizeiptr size;
+	};
+
+	int bufferTargetIndex(GLenum target);
+	bool changed(bool differs);
+
+	GLuint program_;
+	GLuint vertex_array_;
+	GLuint buffers_[BUFFER_TARGET_COUNT];
+	IndexedBinding storage_buffers_[STORAGE_BINDING_COUNT];
+	GLenum polygon_mode_;
+	GLuint blend_;
+	GLenum blend_source_;
+	GLenum blend_destination_;
+	GLuint depth_test_;
+	GLuint depth_mask_;
+	float clear_color_[4];
+	bool clear_color_known_;
+
+	int issued_count_;
+	int suppressed_count_;
+	int program_bind_count_;
+	int vertex_array_bind_count_;
+};
+
+extern GLStateCache gl_state;
+
+#endif
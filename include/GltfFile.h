@@ -0,0 +1,90 @@
+#ifndef GLTFFILE_H
+#define GLTFFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "JobSystem.h"
+#include "MappedFile.h"
+#include "Prism.h"
+
+struct JsonValue;
+struct GltfAccessor;
+
+// A node of the scene hierarchy with its local transform. Nodes are listed
+// parents first, parent indexes the same list and is -1 for roots.
+struct GltfNode {
+	int parent;
+	glm::mat4 transform;
+};
+
+// One placement of a primitive, relative to the node that references it:
+// identity, or an EXT_mesh_gpu_instancing transform
+struct GltfInstance {
+	int primitive;
+	int node;
+	glm::mat4 transform;
+};
+
+// Loads glTF 2.0 (.gltf with external or embedded buffers, or .glb) scenes,
+// positions and indices only. Buffers are memory mapped, and primitives whose
+// accessors are already tightly packed floats and 32 bit indices are handed
+// to the mesh pool as views into the mapping with no copy. Other layouts are
+// converted. Primitives are built in parallel on the job system.
+//
+// Every glTF primitive becomes one mesh, placed once per node and instance
+// that references it. Nodes keep their hierarchy, so placements can follow
+// nodes that move. The GltfFile must outlive the Prisms it returns.
+class GltfFile {
+public:
+	GltfFile(JobSystem& jobs);
+	bool open(const std::string& path);
+	int getPrimitiveCount();
+	Prism getPrism(int primitive);
+	int getPrimitiveMaterial(int primitive);
+	const std::vector<glm::vec4>& getMaterialColors();
+	const std::vector<GltfNode>& getNodes();
+	const std::vector<GltfInstance>& getInstances();
+	size_t getSize();
+	int getCopiedCount();
+	void close();
+
+private:
+	struct Primitive {
+		int position;
+		int indices;
+		int mode;
+		int material;
+	};
+
+	// Each returns nullptr or what was wrong, primitives are built on workers
+	const char* loadBuffers(const JsonValue& root, const std::string& directory, const uint8_t* bin, size_t bin_size);
+	const char* loadBufferViews(const JsonValue& root);
+	const char* loadAccessor(const JsonValue& root, int index, GltfAccessor& accessor);
+	const char* loadMeshes(const JsonValue& root);
+	const char* buildPrimitive(const JsonValue& root, const Primitive& primitive, Prism& prism, bool& copied);
+	const char* loadNodes(const JsonValue& root);
+
+	JobSystem& jobs_;
+	MappedFile file_;
+	std::vector<std::unique_ptr<MappedFile>> external_;
+	std::vector<std::vector<uint8_t>> embedded_;
+	std::vector<const uint8_t*> buffers_;
+	std::vector<size_t> buffer_sizes_;
+	std::vector<const uint8_t*> views_;
+	std::vector<size_t> view_sizes_;
+	std::vector<size_t> view_strides_;
+	std::vector<Primitive> primitives_;
+	std::vector<int> mesh_primitives_;
+	std::vector<Prism> prisms_;
+	std::vector<glm::vec4> material_colors_;
+	std::vector<GltfNode> nodes_;
+	std::vector<GltfInstance> instances_;
+	size_t size_;
+	int copied_count_;
+};
+
+#endif
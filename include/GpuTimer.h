@@ -0,0 +1,30 @@
+#ifndef GPUTIMER_H
+#define GPUTIMER_H
+
+#include <glad/glad.h>
+
+// Measures GPU time with a small ring of GL_TIME_ELAPSED queries. Results are
+// read a few frames late, only once the driver reports them available, so
+// timing never stalls the pipeline.
+class GpuTimer {
+public:
+	GpuTimer();
+	void initialize();
+	void begin();
+	void end();
+	float getMilliseconds();
+	void destroy();
+
+private:
+	static const int QUERY_COUNT = 4;
+
+	void collectResults();
+
+	GLuint queries_[QUERY_COUNT];
+	bool pending_[QUERY_COUNT];
+	int current_;
+	bool active_;
+	float milliseconds_;
+};
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef HUD_H
+#define HUD_H
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <vector>
+#include "RingBuffer.h"
+#include "ShaderManager.h"
+
+struct FrameStats {
+	float frame_ms;
+	float gpu_ms;
+	int draw_calls;
+	int visible_prisms;
+	int triangles;
+	int program_binds;
+	int vertex_array_binds;
+	int gl_calls_issued;
+	int gl_calls_suppressed;
+	int streaming_pending;
+	long uploaded_bytes;
+};
+
+// Performance overlay. All text and graph geometry is generated on the CPU
+// into one vertex array each frame, streamed through the frame ring buffer
+// and drawn with a single glDrawArrays.
+class Hud {
+public:
+	Hud();
+	void initialize(RingBuffer& ring, ShaderManager& shaders);
+	void toggle();
+	bool isVisible();
+	void draw(const FrameStats& stats, int screen_width, int screen_height, RingBuffer& ring);
+	void destroy();
+
+private:
+	struct Vertex {
+		float x, y;
+		uint8_t r, g, b, a;
+	};
+
+	static const int HISTORY_SIZE = 120;
+
+	void addQuad(float x, float y, float w, float h, uint32_t color);
+	void addText(float x, float y, const char* text, uint32_t color);
+	void addGraph(float x, float y, float w, float h);
+
+	bool visible_;
+	ShaderManager* shaders_;
+	ShaderHandle program_;
+	GLuint vao_;
+	GLint screen_size_location_;
+	std::vector<Vertex> vertices_;
+	float frame_history_[HISTORY_SIZE];
+	int history_head_;
+};
+
+#endif
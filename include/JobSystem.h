@@ -0,0 +1,60 @@
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct Job {
+	std::function<void()> work;
+	std::atomic<int> pending_dependencies;
+	std::atomic<bool> finished;
+	std::mutex continuation_mutex;
+	std::vector<std::shared_ptr<Job>> continuations;
+};
+
+typedef std::shared_ptr<Job> JobHandle;
+
+// Work-stealing thread pool. Every worker has its own deque: it pushes and
+// pops at the back, idle threads steal from the front. Threads that are not
+// workers of this system submit to a shared injection queue, queue 0, which
+// is taken from the front by everyone. A job only becomes runnable once all
+// of its dependencies have finished. Waiting threads run jobs instead of
+// blocking. A negative worker count uses every remaining hardware thread.
+class JobSystem {
+public:
+	JobSystem(int worker_count);
+	~JobSystem();
+	JobHandle schedule(std::function<void()> work);
+	JobHandle schedule(std::function<void()> work, const std::vector<JobHandle>& dependencies);
+	void wait(const JobHandle& job);
+	void parallelFor(int begin, int end, int grain, const std::function<void(int, int)>& body);
+	int getThreadCount();
+
+private:
+	struct WorkQueue {
+		std::mutex mutex;
+		std::deque<JobHandle> jobs;
+	};
+
+	int getQueueIndex();
+	void push(const JobHandle& job);
+	JobHandle pop();
+	bool runOne();
+	void finish(const JobHandle& job);
+	void workerLoop(int index);
+
+	std::vector<std::unique_ptr<WorkQueue>> queues_;
+	std::vector<std::thread> workers_;
+	std::atomic<int> queued_;
+	std::atomic<bool> running_;
+	std::mutex sleep_mutex_;
+	std::condition_variable wake_;
+};
+
+#endif
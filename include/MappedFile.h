@@ -0,0 +1,28 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file. Pages are loaded by the OS as
+// they are touched, so parsers can work on the file in place from several
+// threads without reading it into a buffer first.
+class MappedFile {
+public:
+	MappedFile();
+	~MappedFile();
+	bool open(const std::string& path);
+	const char* getData();
+	size_t getSize();
+	void close();
+
+private:
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	int descriptor_;
+	const char* data_;
+	size_t size_;
+};
+
+#endif
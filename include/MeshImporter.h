@@ -0,0 +1,43 @@
+#ifndef MESHIMPORTER_H
+#define MESHIMPORTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "JobSystem.h"
+
+struct PlyElement;
+
+// Triangle mesh read from a model file, positions only
+struct ImportedMesh {
+	std::vector<float> vertices;
+	std::vector<unsigned int> indices;
+};
+
+// Imports OBJ and ASCII or binary PLY files as indexed triangle meshes. The
+// file is memory mapped and cut into chunks at line boundaries, which are
+// parsed in parallel on the job system with a hand-written number parser.
+// Polygons are fan triangulated, and positions that occur more than once are
+// merged through a hash table, so the result goes to the mesh pool as is.
+class MeshImporter {
+public:
+	MeshImporter(JobSystem& jobs);
+	bool load(const std::string& path, ImportedMesh& mesh);
+	bool parseObj(const char* data, size_t size, ImportedMesh& mesh);
+	bool parsePly(const char* data, size_t size, ImportedMesh& mesh);
+	size_t getMergedCount();
+
+	static const size_t CHUNK_SIZE = 4 * 1024 * 1024;
+
+private:
+	bool parsePlyAscii(const char* body, const char* end, const std::vector<PlyElement>& elements, ImportedMesh& mesh);
+	bool parsePlyBinary(const char* body, const char* end, const std::vector<PlyElement>& elements, bool swap,
+						ImportedMesh& mesh);
+	bool mergeDuplicates(ImportedMesh& mesh);
+
+	JobSystem& jobs_;
+	size_t merged_count_;
+};
+
+#endif
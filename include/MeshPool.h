@@ -0,0 +1,116 @@
+#ifndef MESHPOOL_H
+#define MESHPOOL_H
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <vector>
+#include "FreeListAllocator.h"
+#include "Prism.h"
+
+typedef uint32_t MeshHandle;
+
+// Vertex formats a page can hold side by side. Values are read by the
+// vertex pulling shader, keep them in sync.
+enum VertexFormat : uint32_t {
+	VERTEX_FORMAT_FLOAT3 = 0,	// Three floats, three words
+	VERTEX_FORMAT_UNORM16X3 = 1	// Three normalized shorts over the mesh bounds, two words
+};
+
+// Location of one mesh inside a pool page. base_vertex is in vertices of the
+// mesh's format for drawing through a vertex array, first_word is the same
+// position in 32 bit words for shaders that fetch vertices themselves.
+struct MeshRange {
+	int page;
+	GLint base_vertex;
+	GLsizei vertex_count;
+	GLuint first_index;
+	GLsizei index_count;
+	VertexFormat format;
+	GLuint first_word;
+	float position_scale[3];
+	float position_offset[3];
+};
+
+// Suballocates prism geometry from large shared VBO/EBO pages so meshes can
+// be added and removed at runtime with uploads proportional to their size.
+// Freed space is compacted a little every frame by moving the highest mesh
+// of a page into the lowest hole that fits, entirely on the GPU.
+//
+// Vertex storage is allocated in words, so meshes of different formats share
+// a page. Each page has one vertex array per format; shaders pulling vertices
+// from the page buffers as SSBOs need none of them.
+//
+// Instances of one mesh share its storage: retain() adds a reference and
+// remove() only frees the mesh once the last reference is gone. Its storage
+// is reused right away, but the handle is only reused retire_frames
+// endFrame() calls later. Frame snapshots still in flight see the range as
+// removed until then, instead of drawing whichever mesh took the handle.
+//
+// Streamed meshes are reserve()d first and filled by GPU copies from a
+// staging buffer over as many calls as the upload budget needs. Offsets and
+// sizes of the copies are in bytes within the mesh's vertex or index data.
+// Quantized meshes are reserved with the scale and offset their words were
+// packed with by quantizePositions().
+class MeshPool {
+public:
+	MeshPool(GLsizei page_vertices, GLsizei page_indices, int retire_frames);
+	MeshHandle add(Prism& prism, VertexFormat format = VERTEX_FORMAT_FLOAT3);
+	MeshHandle reserve(GLsizei vertex_count, GLsizei index_count, VertexFormat format = VERTEX_FORMAT_FLOAT3,
+					   const float* position_scale = nullptr, const float* position_offset = nullptr);
+	void copyVertices(MeshHandle handle, GLuint source, GLintptr source_offset, GLintptr offset, GLsizeiptr size);
+	void copyIndices(MeshHandle handle, GLuint source, GLintptr source_offset, GLintptr offset, GLsizeiptr size);
+	void retain(MeshHandle handle);
+	void remove(MeshHandle handle);
+	const MeshRange& getRange(MeshHandle handle);
+	void defragment(GLsizeiptr byte_budget);
+	void endFrame();
+	int getPageCount();
+	GLuint getVertexArray(int page, VertexFormat format = VERTEX_FORMAT_FLOAT3);
+	GLuint getVertexBuffer(int page);
+	GLuint getIndexBuffer(int page);
+	void destroy();
+
+	static GLsizei getVertexWords(VertexFormat format);
+	// Packs float positions as VERTEX_FORMAT_UNORM16X3 words over their bounds
+	static void quantizePositions(const float* positions, GLsizei vertex_count, float scale[3], float offset[3],
+								  std::vector<uint32_t>& words);
+
+private:
+	struct RetiredHandle {
+		MeshHandle handle;
+		uint64_t frame;
+	};
+
+	struct Page {
+		Page(GLsizei vertex_words, GLsizei index_capacity);
+
+		GLuint vao;
+		GLuint quantized_vao;
+		GLuint vbo;
+		GLuint ebo;
+		FreeListAllocator vertices;
+		FreeListAllocator indices;
+		std::map<long, MeshHandle> vertex_owners;
+		std::map<long, MeshHandle> index_owners;
+	};
+
+	int createPage(GLsizei vertex_words, GLsizei index_capacity);
+	MeshHandle allocateRange(MeshRange& range, GLsizei word_count, GLsizei stride);
+	GLsizeiptr compactVertices(Page& page, GLsizeiptr byte_budget);
+	GLsizeiptr compactIndices(Page& page, GLsizeiptr byte_budget);
+
+	GLsizei page_vertices_;
+	GLsizei page_indices_;
+	std::vector<Page> pages_;
+	std::vector<MeshRange> ranges_;
+	std::vector<int> references_;
+	std::vector<MeshHandle> free_handles_;
+	std::deque<RetiredHandle> retired_;
+	int retire_frames_;
+	uint64_t frame_;
+};
+
+#endif
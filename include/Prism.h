@@ -1,9 +1,15 @@
 #ifndef PRISM_H
 #define PRISM_H
 
+#include <memory>
+#include <vector>
+
+// Vertex positions (three floats each) and triangle indices. Either views
+// arrays owned by the caller, or owns its geometry, shared between copies.
 class Prism {
 public:
 	Prism(float* vertices, int vertex_count, unsigned int* indices, int index_count);
+	Prism(std::vector<float> vertices, std::vector<unsigned int> indices);
 	float* getVertices();
 	int getVertexCount();
 	unsigned int* getIndices();
@@ -14,6 +20,8 @@ private:
 	int vertex_count_;
 	unsigned int* indices_;
 	int index_count_;
+	std::shared_ptr<std::vector<float>> owned_vertices_;
+	std::shared_ptr<std::vector<unsigned int>> owned_indices_;
 };
 
 #endif
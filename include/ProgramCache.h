@@ -0,0 +1,37 @@
+#ifndef PROGRAMCACHE_H
+#define PROGRAMCACHE_H
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// On-disk cache of linked program binaries. Entries are keyed by a hash of
+// the shader sources and the driver's vendor, renderer and version strings,
+// so a driver update or a source edit selects a different entry. Binaries
+// the driver rejects are deleted so the caller rebuilds from source.
+class ProgramCache {
+public:
+	ProgramCache();
+	void initialize(const std::string& directory);
+	bool isSupported();
+	uint64_t makeKey(const std::string& vertex_source, const std::string& fragment_source,
+					 const std::string& geometry_source);
+	bool load(GLuint program, uint64_t key);
+	void store(GLuint program, uint64_t key);
+	int getHitCount();
+	int getMissCount();
+
+private:
+	std::string entryPath(uint64_t key);
+
+	std::string directory_;
+	std::string driver_;
+	bool supported_;
+	int hit_count_;
+	int miss_count_;
+};
+
+uint64_t hashBytes(const void* data, size_t size, uint64_t hash);
+
+#endif
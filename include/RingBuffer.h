@@ -0,0 +1,50 @@
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <vector>
+
+struct RingAllocation {
+	void* data;
+	GLintptr offset;
+};
+
+// Streams per-frame data through one persistently mapped buffer split into
+// three frame regions. A fence is placed after each frame's commands and
+// waited on before its region is written again, so writes never race the GPU
+// and the driver never has to copy or synchronize implicitly.
+//
+// Without GL 4.4 buffer storage, allocations are staged in client memory and
+// uploaded by flush() with glBufferSubData.
+//
+// resize() replaces the buffer between frames. Its id changes, so it is for
+// rings whose users look the buffer up every frame.
+class RingBuffer {
+public:
+	RingBuffer(GLsizeiptr frame_size);
+	void initialize();
+	void beginFrame();
+	RingAllocation allocate(GLsizeiptr size, GLsizeiptr alignment);
+	void flush();
+	void endFrame();
+	void resize(GLsizeiptr frame_size);
+	GLsizeiptr getFrameSize();
+	GLuint getBuffer();
+	void destroy();
+
+private:
+	static const int FRAME_COUNT = 3;
+
+	GLsizeiptr frame_size_;
+	GLuint buffer_;
+	uint8_t* mapped_;
+	bool persistent_;
+	std::vector<uint8_t> staging_;
+	GLsync fences_[FRAME_COUNT];
+	int frame_;
+	GLsizeiptr head_;
+	GLsizeiptr flushed_;
+};
+
+#endif
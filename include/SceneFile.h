@@ -0,0 +1,115 @@
+#ifndef SCENEFILE_H
+#define SCENEFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+#include "MeshImporter.h"
+#include "Prism.h"
+
+// Binary scene container (.d3s), little endian. A header and section table
+// are followed by sections aligned to SCENE_SECTION_ALIGNMENT, each an array
+// of one record type, laid out exactly as the GL buffers and the code use
+// them. Loading maps the file and hands the vertex and index sections to
+// the mesh pool as they are, so there is nothing to parse or convert.
+#define SCENE_FILE_MAGIC "D3SC"
+#define SCENE_FILE_VERSION 1
+#define SCENE_SECTION_ALIGNMENT 64
+
+enum SceneSectionType : uint32_t {
+	SCENE_SECTION_MESHES = 1,	// SceneMeshRecord
+	SCENE_SECTION_VERTICES = 2,	// Three floats per vertex
+	SCENE_SECTION_INDICES = 3,	// uint32, relative to the mesh's first vertex
+	SCENE_SECTION_LODS = 4,		// SceneLodRecord
+	SCENE_SECTION_MESHLETS = 5	// SceneMeshletRecord
+};
+
+struct SceneFileHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t section_count;
+	uint32_t reserved;
+	uint64_t file_size;
+};
+
+struct SceneSection {
+	uint32_t type;
+	uint32_t reserved;
+	uint64_t offset;
+	uint64_t size;
+};
+
+// Indices start at first_index with LOD 0, index_count long, followed by
+// the coarser levels. lod_count includes LOD 0.
+struct SceneMeshRecord {
+	uint64_t first_vertex;
+	uint64_t first_index;
+	uint32_t vertex_count;
+	uint32_t index_count;
+	uint32_t first_lod;
+	uint32_t lod_count;
+	uint32_t first_meshlet;
+	uint32_t meshlet_count;
+	float bounds_min[3];
+	float bounds_max[3];
+};
+
+// first_index is relative to the mesh's first_index. cell_size is the
+// clustering grid the level was built with, a bound on its geometric error.
+struct SceneLodRecord {
+	uint32_t first_index;
+	uint32_t index_count;
+	float cell_size;
+	uint32_t reserved;
+};
+
+// Consecutive LOD 0 triangles sharing at most SCENE_MESHLET_VERTICES
+// vertices, with a bounding sphere for culling. first_index is relative to
+// the mesh's first_index.
+struct SceneMeshletRecord {
+	uint32_t first_index;
+	uint32_t triangle_count;
+	uint32_t vertex_count;
+	uint32_t reserved;
+	float center[3];
+	float radius;
+};
+
+#define SCENE_MESHLET_VERTICES 64
+#define SCENE_MESHLET_TRIANGLES 124
+#define SCENE_MAX_LODS 4
+
+// Read side: maps a scene file and checks every section and mesh range
+// against the file size once, after which meshes are plain views into the
+// mapping. The SceneFile must outlive the Prisms it returns.
+class SceneFile {
+public:
+	SceneFile();
+	bool open(const std::string& path);
+	int getMeshCount();
+	const SceneMeshRecord& getMesh(int mesh);
+	Prism getPrism(int mesh);
+	const SceneLodRecord* getLods(int mesh);
+	const SceneMeshletRecord* getMeshlets(int mesh);
+	size_t getSize();
+	void close();
+
+private:
+	const uint8_t* findSection(SceneSectionType type, size_t record_size, size_t& count);
+
+	MappedFile file_;
+	const SceneMeshRecord* meshes_;
+	const float* vertices_;
+	const uint32_t* indices_;
+	const SceneLodRecord* lods_;
+	const SceneMeshletRecord* meshlets_;
+	size_t mesh_count_;
+};
+
+// Write side, used by ./d3 --convert: builds the LOD chain by vertex
+// clustering and splits LOD 0 into meshlets, then writes the sections
+bool writeSceneFile(const std::string& path, const std::vector<ImportedMesh>& meshes);
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef SCENEGRAPH_H
+#define SCENEGRAPH_H
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Same layout as entity handles: slot in the low 32 bits, generation above
+typedef uint64_t SceneNode;
+
+#define INVALID_SCENE_NODE 0xFFFFFFFFFFFFFFFFull
+#define SCENE_NODE_INDEX_BITS 32
+#define SCENE_NODE_MAX_COUNT (1u << 24)
+
+// Transform hierarchy kept in flat arrays in depth-first order, so every
+// parent comes before its children and a node's subtree is the contiguous
+// range that follows it. Changing a local transform only sets the node's
+// dirty flag; update() then walks the dirty nodes in order and recomputes
+// each one's subtree range once, skipping nodes an earlier range already
+// covered. The cost of an update is the number of nodes below changes, not
+// the size of the graph.
+//
+// Creating a node inserts it at the end of its parent's subtree, which is
+// an append when a hierarchy is built parents first. Destroying a node
+// removes its whole subtree.
+class SceneGraph {
+public:
+	SceneGraph();
+	SceneNode create(SceneNode parent = INVALID_SCENE_NODE);
+	void destroy(SceneNode node);
+	bool isAlive(SceneNode node);
+	int getCount();
+
+	void setLocalTransform(SceneNode node, const glm::mat4& transform);
+	const glm::mat4& getLocalTransform(SceneNode node);
+	const glm::mat4& getWorldTransform(SceneNode node);
+	glm::mat4 resolveWorldTransform(SceneNode node);
+	int update();
+
+private:
+	int getIndex(SceneNode node);
+
+	std::vector<int> parents_;
+	std::vector<int> subtree_sizes_;
+	std::vector<glm::mat4> local_;
+	std::vector<glm::mat4> world_;
+	std::vector<uint8_t> dirty_;
+	std::vector<SceneNode> dirty_nodes_;
+
+	std::vector<SceneNode> dense_to_handle_;
+	std::vector<uint32_t> slot_to_dense_;
+	std::vector<uint32_t> generations_;
+	std::vector<uint32_t> free_slots_;
+};
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef SHADERMANAGER_H
+#define SHADERMANAGER_H
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "ProgramCache.h"
+
+#ifndef GL_MAX_SHADER_COMPILER_THREADS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+typedef int ShaderHandle;
+
+// Feature bits for shader permutations. Each set bit is injected as a
+// #define after the #version line, so a variant contains only the code for
+// its features instead of branching on them at runtime. Features that need
+// a newer GLSL version raise the #version of every stage of the variant.
+enum ShaderFeature : uint32_t {
+	SHADER_QUANTIZED_POSITIONS = 1 << 0,
+	SHADER_WIREFRAME = 1 << 1,
+	SHADER_LIGHTING = 1 << 2,
+	SHADER_VERTEX_PULLING = 1 << 3,
+	SHADER_DRAW_TABLES = 1 << 4
+};
+
+#define SHADER_FEATURE_COUNT 5
+
+// Builds every shader program up front without waiting on the driver.
+// Programs come from the binary cache when possible; the rest are compiled
+// and linked immediately, and with GL_KHR_parallel_shader_compile the driver
+// does that on its own threads while the caller keeps loading. poll() picks
+// up finished programs without blocking, get() only stalls for a program
+// that is still compiling when it is first needed. Variants are only built
+// the first time a feature set is requested.
+class ShaderManager {
+public:
+	ShaderManager(ProgramCache& cache);
+	void initialize(GLADloadproc load);
+	ShaderHandle request(const char* name, const char* vertex_source, const char* fragment_source,
+						 const char* geometry_source = nullptr);
+	ShaderHandle requestVariant(const char* name, const char* vertex_source, const char* fragment_source,
+								uint32_t features, const char* geometry_source = nullptr);
+	void poll();
+	bool isReady(ShaderHandle handle);
+	GLuint get(ShaderHandle handle);
+	int getPendingCount();
+	void setCacheEnabled(bool enabled);
+	void destroy();
+
+private:
+	struct Program {
+		std::string name;
+		std::string vertex_source;
+		std::string fragment_source;
+		std::string geometry_source;
+		uint64_t key;
+		GLuint program;
+		GLuint vertex_shader;
+		GLuint fragment_shader;
+		GLuint geometry_shader;
+		bool ready;
+	};
+
+	void finish(Program& program);
+
+	ProgramCache& cache_;
+	std::vector<Program> programs_;
+	std::map<std::pair<std::string, uint32_t>, ShaderHandle> variants_;
+	bool parallel_;
+	bool cache_enabled_;
+	int pending_count_;
+};
+
+#endif
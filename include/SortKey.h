@@ -0,0 +1,28 @@
+#ifndef SORTKEY_H
+#define SORTKEY_H
+
+#include <cstdint>
+#include <vector>
+
+// Draw sort key, most significant field first:
+//   pass 4 bits | program 10 bits | material 14 bits | vertex array 12 bits | depth 24 bits
+// Sorting by key groups draws by the state they need, so binds only happen
+// when a field changes, and orders draws front to back within a group.
+#define SORT_KEY_PASS_BITS 4
+#define SORT_KEY_PROGRAM_BITS 10
+#define SORT_KEY_MATERIAL_BITS 14
+#define SORT_KEY_VERTEX_ARRAY_BITS 12
+#define SORT_KEY_DEPTH_BITS 24
+
+struct SortItem {
+	uint64_t key;
+	uint32_t index;
+};
+
+uint64_t makeSortKey(uint32_t pass, uint32_t program, uint32_t material, uint32_t vertex_array, float depth);
+
+// LSD radix sort on 8 bit digits. Digits that are equal across all keys are
+// skipped, so a frame that only differs in depth costs three passes.
+void radixSort(std::vector<SortItem>& items, std::vector<SortItem>& scratch);
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef TRANSFORMKERNELS_H
+#define TRANSFORMKERNELS_H
+
+#include <glm/glm.hpp>
+
+// Position, rotation quaternion and scale of many objects, one array per
+// scalar, all indexed the same
+struct TransformArrays {
+	const float* position_x;
+	const float* position_y;
+	const float* position_z;
+	const float* rotation_x;
+	const float* rotation_y;
+	const float* rotation_z;
+	const float* rotation_w;
+	const float* scale_x;
+	const float* scale_y;
+	const float* scale_z;
+};
+
+enum TransformKernel {
+	TRANSFORM_KERNEL_SCALAR,
+	TRANSFORM_KERNEL_SSE,		// 4 objects per step
+	TRANSFORM_KERNEL_AVX2,		// 8 objects per step, with FMA
+	TRANSFORM_KERNEL_AVX512,	// 16 objects per step
+	TRANSFORM_KERNEL_COUNT,
+	TRANSFORM_KERNEL_BEST = TRANSFORM_KERNEL_COUNT
+};
+
+bool isTransformKernelSupported(TransformKernel kernel);
+const char* getTransformKernelName(TransformKernel kernel);
+
+// Best kernel the CPU supports, detected once
+TransformKernel getBestTransformKernel();
+
+// Composes translation * rotation * scale into world[i] for i in
+// [begin, end), and view_projection * world[i] into mvp[i] when an mvp
+// array is given. The SIMD kernels load one scalar of several objects per
+// register, do the math lane-parallel and transpose 4x4 blocks back into
+// column-major matrices; the tail is finished by the scalar kernel.
+void composeTransforms(const TransformArrays& transforms, int begin, int end, glm::mat4* world,
+					   const glm::mat4* view_projection = nullptr, glm::mat4* mvp = nullptr,
+					   TransformKernel kernel = TRANSFORM_KERNEL_BEST);
+
+#endif
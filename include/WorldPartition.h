@@ -0,0 +1,68 @@
+#ifndef WORLDPARTITION_H
+#define WORLDPARTITION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include <glm/glm.hpp>
+#include "AssetStreamer.h"
+
+// Builds the meshes of one grid cell, on the streamer's thread. Placements
+// are relative to the chunk's corner, see getOrigin().
+typedef std::function<void(int x, int z, std::vector<StreamedMesh>& meshes)> ChunkSource;
+
+// Splits an unbounded world into square chunks on the xz plane that are
+// streamed in and out around the camera. A chunk is wanted while its
+// distance to the camera, shortened by up to prefetch_distance when it lies
+// ahead, is within load_radius, so loading runs ahead of the camera. Chunks
+// are evicted a chunk size further out, which stops them toggling at the
+// edge. Nearest chunks load first, a few at a time so requests never queue
+// up behind a moving camera, and no more is loaded than memory_cap bytes of
+// geometry; past the cap the lowest priority resident chunk makes room.
+//
+// Every load gets a new id that tags its meshes. Meshes whose chunk has been
+// evicted by the time they finish uploading are dropped by accept().
+class WorldPartition {
+public:
+	WorldPartition(AssetStreamer& streamer, ChunkSource source, float chunk_size, float load_radius,
+				   float prefetch_distance, size_t memory_cap);
+	void update(const glm::vec3& position, const glm::vec3& front, std::vector<uint32_t>& evicted);
+	bool accept(uint32_t chunk);
+	bool getOrigin(uint32_t chunk, glm::vec3& origin);
+	int getResidentCount();
+	size_t getResidentBytes();
+
+	static const int MAX_LOADS_IN_FLIGHT = 2;
+
+private:
+	struct Chunk {
+		uint32_t id;
+		size_t bytes;
+		bool loaded;
+		float priority;
+	};
+
+	float getPriority(int x, int z, const glm::vec3& position, const glm::vec3& front);
+
+	AssetStreamer& streamer_;
+	ChunkSource source_;
+	float chunk_size_;
+	float load_radius_;
+	float prefetch_distance_;
+	size_t memory_cap_;
+	std::map<std::pair<int, int>, Chunk> chunks_;
+	std::map<uint32_t, std::pair<int, int>> ids_;
+	uint32_t next_id_;
+	size_t resident_bytes_;
+	int loads_in_flight_;
+
+	// Filled by the streamer's thread as loads finish
+	std::mutex loaded_mutex_;
+	std::vector<std::pair<uint32_t, size_t>> loaded_;
+};
+
+#endif
@@ -0,0 +1,181 @@
+#include <cstring>
+#include <utility>
+#include "AssetStreamer.h"
+
+static void touchPages(const void* data, size_t size) {
+	// Meshes may view a file mapping, fault it in here rather than in the
+	// render thread's staging copy
+	const volatile uint8_t* bytes = (const volatile uint8_t*)data;
+	for(size_t offset = 0; offset < size; offset += 4096)
+		(void)bytes[offset];
+}
+
+static void computeBounds(StreamedMesh& mesh) {
+	const float* vertices = mesh.prism.getVertices();
+	int count = mesh.prism.getVertexCount() / 3;
+	mesh.bounds_min = glm::vec3(vertices[0], vertices[1], vertices[2]);
+	mesh.bounds_max = mesh.bounds_min;
+	for(int i = 1; i < count; i++) {
+		glm::vec3 vertex(vertices[i * 3], vertices[i * 3 + 1], vertices[i * 3 + 2]);
+		mesh.bounds_min = glm::min(mesh.bounds_min, vertex);
+		mesh.bounds_max = glm::max(mesh.bounds_max, vertex);
+	}
+}
+
+StreamedMesh::StreamedMesh(Prism prism, std::vector<StreamedPlacement> placements, uint32_t group, VertexFormat format)
+	: prism(prism), placements(placements), group(group), format(format), bounds_min(0.0f), bounds_max(0.0f),
+	  position_scale{ 1.0f, 1.0f, 1.0f }, position_offset{ 0.0f, 0.0f, 0.0f } {}
+
+AssetStreamer::AssetStreamer(MeshPool& pool, GLsizeiptr frame_budget)
+	: pool_(pool), staging_(frame_budget), frame_budget_(frame_budget), uploaded_bytes_(0), loading_(0), running_(false) {}
+
+void AssetStreamer::initialize() {
+	staging_.initialize();
+	running_ = true;
+	loader_ = std::thread(&AssetStreamer::loaderLoop, this);
+}
+
+void AssetStreamer::request(std::function<void()> load) {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		requests_.push_back(load);
+		loading_++;
+	}
+	wake_.notify_one();
+}
+
+void AssetStreamer::submit(StreamedMesh mesh) {
+	// Empty meshes have nothing to upload or draw
+	if(mesh.prism.getVertexCount() < 3 || mesh.prism.getIndexCount() == 0 || mesh.placements.empty()) return;
+	// Reading every vertex for the bounds also faults in a mapped file
+	computeBounds(mesh);
+	touchPages(mesh.prism.getIndices(), mesh.prism.getIndexCount() * sizeof(unsigned int));
+	if(mesh.format == VERTEX_FORMAT_UNORM16X3) {
+		MeshPool::quantizePositions(mesh.prism.getVertices(), mesh.prism.getVertexCount() / 3, mesh.position_scale,
+									mesh.position_offset, mesh.quantized);
+	}
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	submitted_.push_back(std::move(mesh));
+}
+
+void AssetStreamer::cancel(uint32_t group) {
+	// Only drops what has been submitted so far, later submissions still arrive
+	std::lock_guard<std::mutex> lock(mutex_);
+	for(size_t i = submitted_.size(); i-- > 0;) {
+		if(submitted_[i].group != group) continue;
+		submitted_[i] = submitted_.back();
+		submitted_.pop_back();
+	}
+
+	std::deque<Upload>::iterator it = uploads_.begin();
+	while(it != uploads_.end()) {
+		if(it->mesh.group != group) {
+			++it;
+			continue;
+		}
+		if(it->reserved) pool_.remove(it->handle);
+		it = uploads_.erase(it);
+	}
+}
+
+bool AssetStreamer::stage(Upload& upload, bool indices) {
+	// Sizes stay multiples of four, so every slice is aligned for the copy
+	// Quantized meshes upload their packed words instead of the floats
+	StreamedMesh& mesh = upload.mesh;
+	Prism& prism = mesh.prism;
+	bool quantized = mesh.format == VERTEX_FORMAT_UNORM16X3;
+	GLsizeiptr total = indices ? (GLsizeiptr)prism.getIndexCount() * sizeof(unsigned int)
+					   : quantized ? (GLsizeiptr)mesh.quantized.size() * sizeof(uint32_t)
+								   : (GLsizeiptr)prism.getVertexCount() * sizeof(float);
+	GLsizeiptr& done = indices ? upload.index_bytes : upload.vertex_bytes;
+	GLsizeiptr size = total - done;
+	GLsizeiptr remaining = (frame_budget_ - uploaded_bytes_) & ~(GLsizeiptr)3;
+	if(size > remaining) size = remaining;
+	if(size == 0) return done == total;
+
+	RingAllocation slice = staging_.allocate(size, sizeof(uint32_t));
+	if(!slice.data) return false;
+	const uint8_t* source = indices ? (const uint8_t*)prism.getIndices()
+							: quantized ? (const uint8_t*)mesh.quantized.data() : (const uint8_t*)prism.getVertices();
+	memcpy(slice.data, source + done, size);
+	staging_.flush();
+
+	if(indices) pool_.copyIndices(upload.handle, staging_.getBuffer(), slice.offset, done, size);
+	else pool_.copyVertices(upload.handle, staging_.getBuffer(), slice.offset, done, size);
+	done += size;
+	uploaded_bytes_ += size;
+	return done == total;
+}
+
+void AssetStreamer::update(const std::function<void(MeshHandle, StreamedMesh&)>& ready) {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		for(size_t i = 0; i < submitted_.size(); i++) {
+			Upload upload = { submitted_[i], 0, false, 0, 0 };
+			uploads_.push_back(upload);
+		}
+		submitted_.clear();
+	}
+
+	// The ring fences each frame's staging region, so slices are never
+	// overwritten before the GPU has copied them out
+	uploaded_bytes_ = 0;
+	staging_.beginFrame();
+	while(!uploads_.empty()) {
+		Upload& upload = uploads_.front();
+		if(!upload.reserved) {
+			StreamedMesh& mesh = upload.mesh;
+			upload.handle = pool_.reserve(mesh.prism.getVertexCount() / 3, mesh.prism.getIndexCount(), mesh.format,
+										  mesh.position_scale, mesh.position_offset);
+			upload.reserved = true;
+		}
+		if(!stage(upload, false) || !stage(upload, true)) break;
+
+		ready(upload.handle, upload.mesh);
+		uploads_.pop_front();
+	}
+	staging_.endFrame();
+}
+
+int AssetStreamer::getPendingCount() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return loading_ + submitted_.size() + uploads_.size();
+}
+
+GLsizeiptr AssetStreamer::getUploadedBytes() {
+	return uploaded_bytes_;
+}
+
+void AssetStreamer::loaderLoop() {
+	std::unique_lock<std::mutex> lock(mutex_);
+	while(true) {
+		wake_.wait(lock, [this]() { return !requests_.empty() || !running_; });
+		if(!running_) return;
+
+		std::function<void()> load = requests_.front();
+		requests_.pop_front();
+		lock.unlock();
+		load();
+		lock.lock();
+		loading_--;
+	}
+}
+
+void AssetStreamer::destroy() {
+	// A load in progress is finished first, anything not yet uploaded is dropped
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		running_ = false;
+		requests_.clear();
+	}
+	wake_.notify_all();
+	if(loader_.joinable()) loader_.join();
+
+	for(size_t i = 0; i < uploads_.size(); i++)
+		if(uploads_[i].reserved) pool_.remove(uploads_[i].handle);
+	uploads_.clear();
+	submitted_.clear();
+	loading_ = 0;
+	staging_.destroy();
+}
@@ -0,0 +1,393 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include "Benchmark.h"
+#include "CollisionWorld.h"
+#include "EntityStore.h"
+#include "JobSystem.h"
+#include "MappedFile.h"
+#include "MeshImporter.h"
+#include "SceneGraph.h"
+#include "TransformKernels.h"
+
+#define BENCHMARK_ITEMS (1 << 20)
+#define BENCHMARK_REPEATS 10
+#define IMPORT_BENCHMARK_GRID 2048
+#define ENTITY_BENCHMARK_COUNT (1 << 20)
+#define SCENE_BENCHMARK_FANOUT 32
+#define SCENE_BENCHMARK_ROOTS 1024
+#define COLLISION_BENCHMARK_MOVES 100000
+
+typedef std::chrono::steady_clock BenchmarkClock;
+
+static double millisecondsSince(BenchmarkClock::time_point start) {
+	return std::chrono::duration<double, std::milli>(BenchmarkClock::now() - start).count();
+}
+
+// Stand-in for per-prism frame work: build a rotation and transform a point
+static void simulateItem(const float* input, float* output) {
+	float angle = input[0] * 0.01f;
+	float c = cosf(angle), s = sinf(angle);
+	for(int i = 0; i < 16; i++) {
+		float x = input[1] * c - input[2] * s;
+		float y = input[1] * s + input[2] * c;
+		output[0] = x + output[0] * 0.5f;
+		output[1] = y + output[1] * 0.5f;
+	}
+}
+
+static void benchmarkJobScaling() {
+	std::vector<float> input(BENCHMARK_ITEMS * 3);
+	std::vector<float> output(BENCHMARK_ITEMS * 2);
+	for(int i = 0; i < BENCHMARK_ITEMS * 3; i++)
+		input[i] = (float)(i % 997);
+
+	int max_threads = std::thread::hardware_concurrency();
+	if(max_threads < 1) max_threads = 1;
+
+	printf("Job system scaling, %d items x %d repeats\n", BENCHMARK_ITEMS, BENCHMARK_REPEATS);
+	double single_thread_ms = 0.0;
+	for(int threads = 1; threads <= max_threads; threads++) {
+		JobSystem jobs(threads - 1);
+
+		BenchmarkClock::time_point start = BenchmarkClock::now();
+		for(int repeat = 0; repeat < BENCHMARK_REPEATS; repeat++) {
+			jobs.parallelFor(0, BENCHMARK_ITEMS, 4096, [&](int begin, int end) {
+				for(int i = begin; i < end; i++)
+					simulateItem(&input[i * 3], &output[i * 2]);
+			});
+		}
+		double ms = millisecondsSince(start) / BENCHMARK_REPEATS;
+		if(threads == 1) single_thread_ms = ms;
+
+		printf("  %2d threads: %8.3f ms  %5.2fx\n", threads, ms, single_thread_ms / ms);
+	}
+}
+
+// Per-object structs as the renderer used to keep them, for comparison
+struct BenchmarkObject {
+	glm::vec3 position;
+	glm::quat rotation;
+	glm::vec3 scale;
+	glm::vec3 local_min;
+	glm::vec3 local_max;
+	glm::mat4 world;
+};
+
+static void benchmarkEntityTransforms() {
+	std::vector<BenchmarkObject> objects(ENTITY_BENCHMARK_COUNT);
+	EntityStore entities;
+	SceneGraph graph;
+	std::vector<float> no_vertices;
+	std::vector<unsigned int> no_indices;
+	Prism prism(no_vertices, no_indices);
+	srand(1);
+	for(int i = 0; i < ENTITY_BENCHMARK_COUNT; i++) {
+		BenchmarkObject& object = objects[i];
+		object.position = glm::vec3(rand() % 1000, rand() % 1000, rand() % 1000);
+		object.rotation = glm::angleAxis((rand() % 628) * 0.01f, glm::normalize(glm::vec3(1.0f, rand() % 7, 2.0f)));
+		object.scale = glm::vec3(1.0f + (rand() % 4));
+		object.local_min = glm::vec3(-1.0f);
+		object.local_max = glm::vec3(1.0f);
+
+		EntityHandle entity = entities.create(0, prism, 0, 0);
+		entities.setTransform(entity, object.position, object.rotation, object.scale);
+		entities.setBounds(entity, object.local_min, object.local_max);
+	}
+
+	int max_threads = std::thread::hardware_concurrency();
+	if(max_threads < 1) max_threads = 1;
+	int thread_counts[2] = { 1, max_threads };
+
+	printf("Entity transforms, %d entities x %d repeats\n", ENTITY_BENCHMARK_COUNT, BENCHMARK_REPEATS);
+	for(int run = 0; run < (max_threads > 1 ? 2 : 1); run++) {
+		JobSystem jobs(thread_counts[run] - 1);
+
+		BenchmarkClock::time_point start = BenchmarkClock::now();
+		for(int repeat = 0; repeat < BENCHMARK_REPEATS; repeat++) {
+			jobs.parallelFor(0, ENTITY_BENCHMARK_COUNT, 4096, [&](int begin, int end) {
+				for(int i = begin; i < end; i++) {
+					BenchmarkObject& object = objects[i];
+					object.world = glm::translate(glm::mat4(1.0f), object.position) * glm::mat4_cast(object.rotation) *
+								   glm::scale(glm::mat4(1.0f), object.scale);
+				}
+			});
+		}
+		double object_ms = millisecondsSince(start) / BENCHMARK_REPEATS;
+
+		start = BenchmarkClock::now();
+		for(int repeat = 0; repeat < BENCHMARK_REPEATS; repeat++) {
+			jobs.parallelFor(0, ENTITY_BENCHMARK_COUNT, 4096, [&](int begin, int end) {
+				entities.updateTransforms(graph, begin, end);
+			});
+		}
+		double store_ms = millisecondsSince(start) / BENCHMARK_REPEATS;
+
+		// The store also produces world bounds, the structs only matrices
+		printf("  %2d threads: structs %8.3f ms  %6.2f ns/entity, store with bounds %8.3f ms  %6.2f ns/entity\n",
+			   thread_counts[run], object_ms, object_ms * 1e6 / ENTITY_BENCHMARK_COUNT, store_ms,
+			   store_ms * 1e6 / ENTITY_BENCHMARK_COUNT);
+	}
+
+	// Churn: destroy every other entity, then refill through the free slots
+	BenchmarkClock::time_point start = BenchmarkClock::now();
+	for(int i = ENTITY_BENCHMARK_COUNT - 1; i >= 0; i -= 2)
+		entities.destroy(entities.getHandle(i));
+	for(int i = 0; i < ENTITY_BENCHMARK_COUNT / 2; i++)
+		entities.create(0, prism, 0, 0);
+	double churn_ms = millisecondsSince(start);
+	printf("  churn: %d destroys and creates in %.3f ms\n", ENTITY_BENCHMARK_COUNT / 2, churn_ms);
+}
+
+// World and MVP matrices for every object on one thread, glm per object
+// against each transform kernel the CPU supports
+static void benchmarkTransformKernels() {
+	std::vector<float> arrays[10];
+	for(int a = 0; a < 10; a++) {
+		arrays[a].resize(ENTITY_BENCHMARK_COUNT);
+		for(int i = 0; i < ENTITY_BENCHMARK_COUNT; i++)
+			arrays[a][i] = (rand() % 2000) / 1000.0f - 1.0f;
+	}
+	TransformArrays transforms = { arrays[0].data(), arrays[1].data(), arrays[2].data(), arrays[3].data(),
+								   arrays[4].data(), arrays[5].data(), arrays[6].data(), arrays[7].data(),
+								   arrays[8].data(), arrays[9].data() };
+	glm::mat4 view_projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f) *
+								glm::lookAt(glm::vec3(0.0f, 0.0f, -3.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	std::vector<glm::mat4> world(ENTITY_BENCHMARK_COUNT);
+	std::vector<glm::mat4> mvp(ENTITY_BENCHMARK_COUNT);
+
+	printf("Transform kernels, world and MVP for %d objects on one thread\n", ENTITY_BENCHMARK_COUNT);
+	BenchmarkClock::time_point start = BenchmarkClock::now();
+	for(int repeat = 0; repeat < BENCHMARK_REPEATS; repeat++) {
+		for(int i = 0; i < ENTITY_BENCHMARK_COUNT; i++) {
+			glm::vec3 position(arrays[0][i], arrays[1][i], arrays[2][i]);
+			glm::quat rotation(arrays[6][i], arrays[3][i], arrays[4][i], arrays[5][i]);
+			glm::vec3 scale(arrays[7][i], arrays[8][i], arrays[9][i]);
+			world[i] = glm::translate(glm::mat4(1.0f), position) * glm::mat4_cast(rotation) *
+					   glm::scale(glm::mat4(1.0f), scale);
+			mvp[i] = view_projection * world[i];
+		}
+	}
+	double glm_ms = millisecondsSince(start) / BENCHMARK_REPEATS;
+	printf("  glm:     %8.3f ms  %7.1f M/s\n", glm_ms, ENTITY_BENCHMARK_COUNT / (glm_ms * 1000.0));
+
+	for(int kernel = 0; kernel < TRANSFORM_KERNEL_COUNT; kernel++) {
+		if(!isTransformKernelSupported((TransformKernel)kernel)) continue;
+		start = BenchmarkClock::now();
+		for(int repeat = 0; repeat < BENCHMARK_REPEATS; repeat++)
+			composeTransforms(transforms, 0, ENTITY_BENCHMARK_COUNT, world.data(), &view_projection, mvp.data(),
+							  (TransformKernel)kernel);
+		double ms = millisecondsSince(start) / BENCHMARK_REPEATS;
+		printf("  %-7s  %8.3f ms  %7.1f M/s  %5.2fx\n", getTransformKernelName((TransformKernel)kernel), ms,
+			   ENTITY_BENCHMARK_COUNT / (ms * 1000.0), glm_ms / ms);
+	}
+}
+
+// Three levels, roots with SCENE_BENCHMARK_FANOUT children each with as many
+// leaves. Changing leaves shows the update cost follows the changed nodes,
+// changing every root is the full recompute for comparison.
+static void benchmarkSceneGraph() {
+	SceneGraph graph;
+	std::vector<SceneNode> roots;
+	std::vector<SceneNode> leaves;
+	for(int r = 0; r < SCENE_BENCHMARK_ROOTS; r++) {
+		SceneNode root = graph.create();
+		roots.push_back(root);
+		graph.setLocalTransform(root, glm::translate(glm::mat4(1.0f), glm::vec3(r * 10.0f, 0.0f, 0.0f)));
+		for(int c = 0; c < SCENE_BENCHMARK_FANOUT; c++) {
+			SceneNode child = graph.create(root);
+			graph.setLocalTransform(child, glm::rotate(glm::mat4(1.0f), c * 0.2f, glm::vec3(0.0f, 1.0f, 0.0f)));
+			for(int l = 0; l < SCENE_BENCHMARK_FANOUT; l++) {
+				SceneNode leaf = graph.create(child);
+				graph.setLocalTransform(leaf, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, l * 0.5f, 1.0f)));
+				leaves.push_back(leaf);
+			}
+		}
+	}
+	graph.update();
+
+	printf("Scene graph update, %d nodes\n", graph.getCount());
+	srand(1);
+	int changed_counts[5] = { 0, 100, 1000, 10000, 100000 };
+	for(int run = 0; run <= 5; run++) {
+		bool full = run == 5;
+		double ms = 0.0;
+		int updated = 0;
+		for(int repeat = 0; repeat < BENCHMARK_REPEATS; repeat++) {
+			glm::mat4 transform = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, repeat * 0.1f, 0.0f));
+			if(full) {
+				for(size_t r = 0; r < roots.size(); r++)
+					graph.setLocalTransform(roots[r], transform);
+			} else {
+				for(int i = 0; i < changed_counts[run]; i++)
+					graph.setLocalTransform(leaves[rand() % leaves.size()], transform);
+			}
+
+			BenchmarkClock::time_point start = BenchmarkClock::now();
+			updated = graph.update();
+			ms += millisecondsSince(start);
+		}
+		ms /= BENCHMARK_REPEATS;
+
+		if(full) printf("  all roots:      %8.3f ms  %7d nodes updated", ms, updated);
+		else printf("  %6d leaves:  %8.3f ms  %7d nodes updated", changed_counts[run], ms, updated);
+		if(updated > 0) printf("  %6.2f ns/node", ms * 1e6 / updated);
+		printf("\n");
+	}
+}
+
+// Boxes scattered at a fixed density over areas of growing size, with a
+// sphere moving a camera step at a time among them. The cost per move
+// should stay flat as the scene grows.
+static void benchmarkCollision() {
+	static float box_vertices[] = { 0, 0, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0, 0, 0, 1, 1, 0, 1, 1, 1, 1, 0, 1, 1 };
+	static unsigned int box_indices[] = { 0, 1, 2, 2, 3, 0, 4, 5, 6, 6, 7, 4, 0, 4, 7, 7, 3, 0,
+										  1, 5, 6, 6, 2, 1, 0, 1, 5, 5, 4, 0, 3, 2, 6, 6, 7, 3 };
+	Prism box(box_vertices, 24, box_indices, 36);
+	std::shared_ptr<CollisionShape> box_shape = std::make_shared<CollisionShape>(box, 2.0f);
+
+	printf("Camera collision, %d sphere moves\n", COLLISION_BENCHMARK_MOVES);
+	int box_counts[3] = { 10000, 100000, 250000 };
+	for(int run = 0; run < 3; run++) {
+		// Four boxes per 10x10 area on the ground, up to 3 units tall
+		float extent = sqrtf(box_counts[run] / 4.0f) * 10.0f;
+		CollisionWorld world(16.0f);
+		srand(1);
+		BenchmarkClock::time_point start = BenchmarkClock::now();
+		for(int i = 0; i < box_counts[run]; i++) {
+			glm::vec3 position((rand() % 10000) / 10000.0f * extent, 0.0f, (rand() % 10000) / 10000.0f * extent);
+			glm::vec3 size(1.0f + rand() % 3, 1.0f + rand() % 3, 1.0f + rand() % 3);
+			world.add(i, box_shape, glm::scale(glm::translate(glm::mat4(1.0f), position), size));
+		}
+		double build_ms = millisecondsSince(start);
+
+		glm::vec3 position(extent * 0.5f, 1.5f, extent * 0.5f);
+		size_t tested = world.getTestedCount();
+		start = BenchmarkClock::now();
+		for(int move = 0; move < COLLISION_BENCHMARK_MOVES; move++) {
+			float angle = (move / 200) * 2.4f;
+			glm::vec3 step(cosf(angle) * 0.1f, ((move / 50) % 2 ? 0.02f : -0.02f), sinf(angle) * 0.1f);
+			position = world.moveSphere(position, 0.2f, step);
+		}
+		double us = millisecondsSince(start) * 1000.0 / COLLISION_BENCHMARK_MOVES;
+
+		printf("  %7d triangles: built in %8.1f ms, %6.3f us/move, %5.1f triangles tested/move\n",
+			   world.getTriangleCount(), build_ms, us,
+			   (world.getTestedCount() - tested) / (double)COLLISION_BENCHMARK_MOVES);
+	}
+}
+
+// Grid of quads with every vertex written once per face corner in the PLY,
+// so the hash merge has real work to do
+static bool writeImportBenchmarkFiles(const std::string& obj_path, const std::string& ply_path) {
+	int grid = IMPORT_BENCHMARK_GRID;
+	FILE* obj = fopen(obj_path.c_str(), "wb");
+	FILE* ply = fopen(ply_path.c_str(), "wb");
+	if(!obj || !ply) {
+		if(obj) fclose(obj);
+		if(ply) fclose(ply);
+		return false;
+	}
+
+	for(int y = 0; y <= grid; y++)
+		for(int x = 0; x <= grid; x++)
+			fprintf(obj, "v %.6f %.6f %.6f\n", x * 0.01f, y * 0.01f, sinf(x * 0.1f) * cosf(y * 0.1f));
+	for(int y = 0; y < grid; y++) {
+		for(int x = 0; x < grid; x++) {
+			int corner = y * (grid + 1) + x + 1;
+			fprintf(obj, "f %d %d %d %d\n", corner, corner + 1, corner + grid + 2, corner + grid + 1);
+		}
+	}
+
+	int triangles = grid * grid * 2;
+	fprintf(ply, "ply\nformat binary_little_endian 1.0\nelement vertex %d\n", triangles * 3);
+	fprintf(ply, "property float x\nproperty float y\nproperty float z\nelement face %d\n", triangles);
+	fprintf(ply, "property list uchar uint vertex_indices\nend_header\n");
+	for(int y = 0; y < grid; y++) {
+		for(int x = 0; x < grid; x++) {
+			int corners[6][2] = { { x, y }, { x + 1, y }, { x + 1, y + 1 }, { x, y }, { x + 1, y + 1 }, { x, y + 1 } };
+			for(int i = 0; i < 6; i++) {
+				float position[3] = { corners[i][0] * 0.01f, corners[i][1] * 0.01f,
+									  sinf(corners[i][0] * 0.1f) * cosf(corners[i][1] * 0.1f) };
+				fwrite(position, sizeof(position), 1, ply);
+			}
+		}
+	}
+	for(unsigned int i = 0; i < (unsigned int)triangles; i++) {
+		unsigned char count = 3;
+		unsigned int face[3] = { i * 3, i * 3 + 1, i * 3 + 2 };
+		fwrite(&count, 1, 1, ply);
+		fwrite(face, sizeof(face), 1, ply);
+	}
+
+	fclose(obj);
+	fclose(ply);
+	return true;
+}
+
+static void benchmarkImportFile(const std::string& path) {
+	MappedFile file;
+	if(!file.open(path)) return;
+	double megabytes = file.getSize() / (1024.0 * 1024.0);
+	file.close();
+
+	int max_threads = std::thread::hardware_concurrency();
+	if(max_threads < 1) max_threads = 1;
+	int thread_counts[2] = { 1, max_threads };
+
+	printf("Import %s, %.1f MB\n", path.c_str(), megabytes);
+	for(int run = 0; run < (max_threads > 1 ? 2 : 1); run++) {
+		JobSystem jobs(thread_counts[run] - 1);
+		MeshImporter importer(jobs);
+
+		// The first load pages the file in, the timed one reads from the page cache
+		ImportedMesh mesh;
+		if(run == 0 && !importer.load(path, mesh)) return;
+		mesh = ImportedMesh();
+
+		BenchmarkClock::time_point start = BenchmarkClock::now();
+		importer.load(path, mesh);
+		double ms = millisecondsSince(start);
+
+		printf("  %2d threads: %9.1f ms  %8.1f MB/s  (%zu vertices, %zu triangles, %zu merged)\n", thread_counts[run],
+			   ms, megabytes / (ms / 1000.0), mesh.vertices.size() / 3, mesh.indices.size() / 3, importer.getMergedCount());
+	}
+}
+
+static void benchmarkImport(const char* path) {
+	if(path) {
+		benchmarkImportFile(path);
+		return;
+	}
+
+	const char* directory = getenv("TMPDIR");
+	std::string base = std::string(directory ? directory : "/tmp") + "/d3_import_benchmark";
+	std::string obj_path = base + ".obj";
+	std::string ply_path = base + ".ply";
+	if(!writeImportBenchmarkFiles(obj_path, ply_path)) {
+		printf("Import benchmark skipped, cannot write %s\n", base.c_str());
+		return;
+	}
+
+	benchmarkImportFile(obj_path);
+	benchmarkImportFile(ply_path);
+	remove(obj_path.c_str());
+	remove(ply_path.c_str());
+}
+
+void runBenchmarks(const char* import_path) {
+	benchmarkJobScaling();
+	benchmarkTransformKernels();
+	benchmarkEntityTransforms();
+	benchmarkSceneGraph();
+	benchmarkCollision();
+	benchmarkImport(import_path);
+}
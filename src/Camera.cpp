@@ -0,0 +1,152 @@
+#include <cmath>
+#include "Camera.h"
+
+Camera::Camera(const glm::vec3& position, float yaw, float pitch, float fov, float aspect, float near_plane,
+			   float far_plane)
+	: position_(position), yaw_(yaw), pitch_(pitch), fov_(fov), aspect_(aspect), near_(near_plane), far_(far_plane),
+	  orientation_dirty_(true), view_dirty_(true), projection_dirty_(true) {}
+
+void Camera::rotate(float yaw, float pitch) {
+	if(yaw == 0.0f && pitch == 0.0f) return;
+	yaw_ += yaw;
+	pitch_ += pitch;
+
+	if(yaw_ > 360.0f) yaw_ -= 360.0f;
+	if(yaw_ < 0.0f) yaw_ += 360.0f;
+
+	if(pitch_ > 90.0f) pitch_ = 90.0f;
+	if(pitch_ < -90.0f) pitch_ = -90.0f;
+	orientation_dirty_ = true;
+}
+
+void Camera::move(const glm::vec3& offset) {
+	if(offset.x == 0.0f && offset.y == 0.0f && offset.z == 0.0f) return;
+	position_ += offset;
+	view_dirty_ = true;
+}
+
+void Camera::setPosition(const glm::vec3& position) {
+	position_ = position;
+	view_dirty_ = true;
+}
+
+void Camera::setProjection(float fov, float aspect, float near_plane, float far_plane) {
+	fov_ = fov;
+	aspect_ = aspect;
+	near_ = near_plane;
+	far_ = far_plane;
+	projection_dirty_ = true;
+}
+
+void Camera::update() {
+	if(orientation_dirty_) {
+		// Yaw about world up, then pitch about the camera's own z. The
+		// columns of the rotation are front, up and right.
+		orientation_ = glm::angleAxis(glm::radians(-yaw_), glm::vec3(0.0f, 1.0f, 0.0f)) *
+					   glm::angleAxis(glm::radians(pitch_), glm::vec3(0.0f, 0.0f, 1.0f));
+		glm::mat3 basis = glm::mat3_cast(orientation_);
+		front_ = basis[0];
+		up_ = basis[1];
+		right_ = basis[2];
+		heading_ = glm::cross(glm::vec3(0.0f, 1.0f, 0.0f), right_);
+		orientation_dirty_ = false;
+		view_dirty_ = true;
+	}
+	if(!view_dirty_ && !projection_dirty_) return;
+
+	if(view_dirty_) {
+		// Same matrix as lookAt, straight from the basis, so looking
+		// straight up or down is not degenerate
+		view_ = glm::mat4(1.0f);
+		for(int axis = 0; axis < 3; axis++) {
+			view_[axis][0] = right_[axis];
+			view_[axis][1] = up_[axis];
+			view_[axis][2] = -front_[axis];
+		}
+		view_[3][0] = -glm::dot(right_, position_);
+		view_[3][1] = -glm::dot(up_, position_);
+		view_[3][2] = glm::dot(front_, position_);
+	}
+	if(projection_dirty_) projection_ = glm::perspective(glm::radians(fov_), aspect_, near_, far_);
+	view_dirty_ = false;
+	projection_dirty_ = false;
+
+	// Planes are sums and differences of the view-projection's rows
+	view_projection_ = projection_ * view_;
+	glm::vec4 rows[4];
+	for(int row = 0; row < 4; row++)
+		rows[row] = glm::vec4(view_projection_[0][row], view_projection_[1][row], view_projection_[2][row],
+							  view_projection_[3][row]);
+	planes_[FRUSTUM_LEFT] = rows[3] + rows[0];
+	planes_[FRUSTUM_RIGHT] = rows[3] - rows[0];
+	planes_[FRUSTUM_BOTTOM] = rows[3] + rows[1];
+	planes_[FRUSTUM_TOP] = rows[3] - rows[1];
+	planes_[FRUSTUM_NEAR] = rows[3] + rows[2];
+	planes_[FRUSTUM_FAR] = rows[3] - rows[2];
+	for(int plane = 0; plane < FRUSTUM_PLANE_COUNT; plane++) {
+		glm::vec4& p = planes_[plane];
+		p = p * (1.0f / sqrtf(p.x * p.x + p.y * p.y + p.z * p.z));
+	}
+}
+
+const glm::vec3& Camera::getPosition() {
+	return position_;
+}
+
+const glm::quat& Camera::getOrientation() {
+	update();
+	return orientation_;
+}
+
+const glm::vec3& Camera::getFront() {
+	update();
+	return front_;
+}
+
+const glm::vec3& Camera::getRight() {
+	update();
+	return right_;
+}
+
+const glm::vec3& Camera::getUp() {
+	update();
+	return up_;
+}
+
+const glm::vec3& Camera::getHeading() {
+	update();
+	return heading_;
+}
+
+const glm::mat4& Camera::getView() {
+	update();
+	return view_;
+}
+
+const glm::mat4& Camera::getProjection() {
+	update();
+	return projection_;
+}
+
+const glm::mat4& Camera::getViewProjection() {
+	update();
+	return view_projection_;
+}
+
+const glm::vec4* Camera::getFrustumPlanes() {
+	update();
+	return planes_;
+}
+
+bool Camera::isBoxVisible(const glm::vec3& min, const glm::vec3& max) {
+	// Outside when the corner furthest along a plane's normal is behind it
+	update();
+	for(int plane = 0; plane < FRUSTUM_PLANE_COUNT; plane++) {
+		const glm::vec4& p = planes_[plane];
+		float x = p.x > 0.0f ? max.x : min.x;
+		float y = p.y > 0.0f ? max.y : min.y;
+		float z = p.z > 0.0f ? max.z : min.z;
+		if(p.x * x + p.y * y + p.z * z + p.w < 0.0f) return false;
+	}
+	return true;
+}
@@ -0,0 +1,150 @@
+#include <cmath>
+#include "CollisionShape.h"
+
+CollisionShape::CollisionShape(Prism& prism, float cell_size)
+	: prism_(prism), bounds_min_(0.0f), bounds_max_(0.0f), cell_size_(cell_size), dimensions_{ 0, 0, 0 } {
+	const unsigned int* indices = prism_.getIndices();
+	int vertex_count = prism_.getVertexCount() / 3;
+
+	// Out of range, non-finite and degenerate triangles cannot be touched
+	for(int i = 0; i + 2 < prism_.getIndexCount(); i += 3) {
+		if(indices[i] >= (unsigned int)vertex_count || indices[i + 1] >= (unsigned int)vertex_count ||
+		   indices[i + 2] >= (unsigned int)vertex_count)
+			continue;
+		glm::vec3 corners[3];
+		bool finite = true;
+		for(int corner = 0; corner < 3; corner++) {
+			const float* v = prism_.getVertices() + indices[i + corner] * 3;
+			corners[corner] = glm::vec3(v[0], v[1], v[2]);
+			finite = finite && std::isfinite(v[0]) && std::isfinite(v[1]) && std::isfinite(v[2]);
+		}
+		if(!finite) continue;
+		if(glm::length(glm::cross(corners[1] - corners[0], corners[2] - corners[0])) < 1e-12f) continue;
+
+		if(triangles_.empty()) bounds_min_ = bounds_max_ = corners[0];
+		for(int corner = 0; corner < 3; corner++) {
+			bounds_min_ = glm::min(bounds_min_, corners[corner]);
+			bounds_max_ = glm::max(bounds_max_, corners[corner]);
+		}
+		triangles_.push_back(i);
+	}
+	int triangle_count = getTriangleCount();
+	if(triangle_count == 0) return;
+
+	// Coarser cells until the grid has no more cells than about twice the
+	// triangles, so a large sparse mesh does not cost an empty grid. Sized in
+	// doubles, where the extent of finite bounds cannot overflow, and done at
+	// the latest once the whole mesh fits in one cell.
+	double cell_limit = 2.0 * triangle_count + 64.0;
+	double cell = cell_size_ > 0.0f ? cell_size_ : 1.0;
+	double extent[3];
+	for(int axis = 0; axis < 3; axis++)
+		extent[axis] = (double)bounds_max_[axis] - (double)bounds_min_[axis];
+	for(;;) {
+		double cell_count = 1.0;
+		for(int axis = 0; axis < 3; axis++)
+			cell_count *= floor(extent[axis] / cell) + 1.0;
+		if(cell_count <= cell_limit || cell_count <= 1.0) break;
+		cell *= 2.0;
+	}
+	cell_size_ = (float)cell;
+	for(int axis = 0; axis < 3; axis++)
+		dimensions_[axis] = (int)floor(extent[axis] / cell) + 1;
+
+	// Count per cell, then place each triangle in its cells' ranges
+	cell_starts_.assign(dimensions_[0] * dimensions_[1] * dimensions_[2] + 1, 0);
+	int cell_min[3], cell_max[3];
+	for(int t = 0; t < triangle_count; t++) {
+		if(!getCellRange(t, cell_min, cell_max)) {
+			overflow_.push_back(t);
+			continue;
+		}
+		for(int z = cell_min[2]; z <= cell_max[2]; z++)
+			for(int y = cell_min[1]; y <= cell_max[1]; y++)
+				for(int x = cell_min[0]; x <= cell_max[0]; x++)
+					cell_starts_[getCellIndex(x, y, z) + 1]++;
+	}
+	for(size_t cell = 1; cell < cell_starts_.size(); cell++)
+		cell_starts_[cell] += cell_starts_[cell - 1];
+
+	std::vector<uint32_t> fill(cell_starts_.begin(), cell_starts_.end() - 1);
+	cell_triangles_.resize(cell_starts_.back());
+	for(int t = 0; t < triangle_count; t++) {
+		if(!getCellRange(t, cell_min, cell_max)) continue;
+		for(int z = cell_min[2]; z <= cell_max[2]; z++)
+			for(int y = cell_min[1]; y <= cell_max[1]; y++)
+				for(int x = cell_min[0]; x <= cell_max[0]; x++)
+					cell_triangles_[fill[getCellIndex(x, y, z)]++] = t;
+	}
+}
+
+void CollisionShape::getCell(const glm::vec3& position, int cell[3]) {
+	for(int axis = 0; axis < 3; axis++) {
+		// Clamped before the conversion, positions far outside may be infinite
+		float c = floorf((position[axis] - bounds_min_[axis]) / cell_size_);
+		if(!(c > 0.0f)) cell[axis] = 0;
+		else cell[axis] = c >= (float)dimensions_[axis] ? dimensions_[axis] - 1 : (int)c;
+	}
+}
+
+bool CollisionShape::getCellRange(uint32_t triangle, int cell_min[3], int cell_max[3]) {
+	glm::vec3 corners[3];
+	getTriangle(triangle, corners);
+	getCell(glm::min(corners[0], glm::min(corners[1], corners[2])), cell_min);
+	getCell(glm::max(corners[0], glm::max(corners[1], corners[2])), cell_max);
+	int cells = 1;
+	for(int axis = 0; axis < 3; axis++)
+		cells *= cell_max[axis] - cell_min[axis] + 1;
+	return cells <= MAX_TRIANGLE_CELLS;
+}
+
+int CollisionShape::getCellIndex(int x, int y, int z) {
+	return (z * dimensions_[1] + y) * dimensions_[0] + x;
+}
+
+void CollisionShape::query(const glm::vec3& min, const glm::vec3& max, std::vector<uint32_t>& triangles) {
+	if(triangles_.empty()) return;
+	for(int axis = 0; axis < 3; axis++)
+		if(min[axis] > bounds_max_[axis] || max[axis] < bounds_min_[axis]) return;
+
+	int cell_min[3], cell_max[3];
+	getCell(min, cell_min);
+	getCell(max, cell_max);
+	for(int z = cell_min[2]; z <= cell_max[2]; z++) {
+		for(int y = cell_min[1]; y <= cell_max[1]; y++) {
+			for(int x = cell_min[0]; x <= cell_max[0]; x++) {
+				int cell = getCellIndex(x, y, z);
+				triangles.insert(triangles.end(), cell_triangles_.begin() + cell_starts_[cell],
+								 cell_triangles_.begin() + cell_starts_[cell + 1]);
+			}
+		}
+	}
+	triangles.insert(triangles.end(), overflow_.begin(), overflow_.end());
+}
+
+void CollisionShape::getTriangle(uint32_t triangle, glm::vec3 corners[3]) {
+	const unsigned int* indices = prism_.getIndices() + triangles_[triangle];
+	for(int corner = 0; corner < 3; corner++) {
+		const float* v = prism_.getVertices() + indices[corner] * 3;
+		corners[corner] = glm::vec3(v[0], v[1], v[2]);
+	}
+}
+
+const glm::vec3& CollisionShape::getBoundsMin() {
+	return bounds_min_;
+}
+
+const glm::vec3& CollisionShape::getBoundsMax() {
+	return bounds_max_;
+}
+
+int CollisionShape::getTriangleCount() {
+	return triangles_.size();
+}
+
+size_t CollisionShape::getByteSize() {
+	// The prism's geometry is counted with the mesh, not here
+	return sizeof(CollisionShape) +
+		   (triangles_.capacity() + cell_starts_.capacity() + cell_triangles_.capacity() + overflow_.capacity()) *
+			   sizeof(uint32_t);
+}
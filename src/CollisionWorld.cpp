@@ -0,0 +1,309 @@
+#include <algorithm>
+#include <cmath>
+#include "CollisionWorld.h"
+
+// Distance kept from contacts after a move, so the next sweep starts just
+// outside and does not report the same contact at time zero
+#define COLLISION_SKIN 0.001f
+
+CollisionWorld::CollisionWorld(float cell_size)
+	: cell_size_(cell_size), triangle_count_(0), stamp_(0), tested_(0) {}
+
+void CollisionWorld::getCell(const glm::vec3& position, int cell[3]) {
+	// Clamped before the conversion, cells wrap around in the key long before
+	for(int axis = 0; axis < 3; axis++)
+		cell[axis] = (int)std::max(-1073741824.0f, std::min(1073741824.0f, floorf(position[axis] / cell_size_)));
+}
+
+uint64_t CollisionWorld::getCellKey(int x, int y, int z) {
+	// 21 bits per axis, cells wrap around far beyond any reachable distance
+	return ((uint64_t)(x & 0x1FFFFF) << 42) | ((uint64_t)(y & 0x1FFFFF) << 21) | (uint64_t)(z & 0x1FFFFF);
+}
+
+void CollisionWorld::transformBounds(const glm::mat4& transform, const glm::vec3& min, const glm::vec3& max,
+									 glm::vec3& out_min, glm::vec3& out_max) {
+	// The center is transformed, the half extent is spread by the absolute axes
+	glm::vec3 center = (min + max) * 0.5f;
+	glm::vec3 extent = (max - min) * 0.5f;
+	for(int row = 0; row < 3; row++) {
+		float c = transform[3][row] + transform[0][row] * center.x + transform[1][row] * center.y +
+				  transform[2][row] * center.z;
+		float e = fabsf(transform[0][row]) * extent.x + fabsf(transform[1][row]) * extent.y +
+				  fabsf(transform[2][row]) * extent.z;
+		out_min[row] = c - e;
+		out_max[row] = c + e;
+	}
+}
+
+void CollisionWorld::add(uint64_t owner, std::shared_ptr<CollisionShape> shape, const glm::mat4& transform) {
+	remove(owner);
+	if(!shape || shape->getTriangleCount() == 0) return;
+
+	// A flattened placement has no inverse to take sweeps into shape space
+	glm::vec3 x(transform[0]), y(transform[1]), z(transform[2]);
+	if(!(fabsf(glm::dot(glm::cross(x, y), z)) >= 1e-12f)) return;
+
+	Instance instance;
+	instance.shape = shape;
+	instance.transform = transform;
+	instance.inverse = glm::inverse(transform);
+	transformBounds(transform, shape->getBoundsMin(), shape->getBoundsMax(), instance.bounds_min,
+					instance.bounds_max);
+	for(int axis = 0; axis < 3; axis++)
+		if(!std::isfinite(instance.bounds_min[axis]) || !std::isfinite(instance.bounds_max[axis])) return;
+	getCell(instance.bounds_min, instance.cell_min);
+	getCell(instance.bounds_max, instance.cell_max);
+	double cells = 1.0;
+	for(int axis = 0; axis < 3; axis++)
+		cells *= (double)instance.cell_max[axis] - instance.cell_min[axis] + 1.0;
+	instance.overflow = cells > MAX_INSTANCE_CELLS;
+
+	uint32_t id;
+	if(!free_instances_.empty()) {
+		id = free_instances_.back();
+		free_instances_.pop_back();
+		instances_[id] = instance;
+	} else {
+		id = instances_.size();
+		instances_.push_back(instance);
+		stamps_.push_back(0);
+	}
+	owners_[owner] = id;
+	triangle_count_ += shape->getTriangleCount();
+
+	if(instance.overflow) {
+		overflow_.push_back(id);
+		return;
+	}
+	for(int z = instance.cell_min[2]; z <= instance.cell_max[2]; z++)
+		for(int y = instance.cell_min[1]; y <= instance.cell_max[1]; y++)
+			for(int x = instance.cell_min[0]; x <= instance.cell_max[0]; x++)
+				cells_[getCellKey(x, y, z)].push_back(id);
+}
+
+void CollisionWorld::remove(uint64_t owner) {
+	std::unordered_map<uint64_t, uint32_t>::iterator it = owners_.find(owner);
+	if(it == owners_.end()) return;
+
+	uint32_t id = it->second;
+	Instance& instance = instances_[id];
+	if(instance.overflow) {
+		std::vector<uint32_t>::iterator found = std::find(overflow_.begin(), overflow_.end(), id);
+		if(found != overflow_.end()) {
+			*found = overflow_.back();
+			overflow_.pop_back();
+		}
+	} else {
+		for(int z = instance.cell_min[2]; z <= instance.cell_max[2]; z++) {
+			for(int y = instance.cell_min[1]; y <= instance.cell_max[1]; y++) {
+				for(int x = instance.cell_min[0]; x <= instance.cell_max[0]; x++) {
+					std::unordered_map<uint64_t, std::vector<uint32_t>>::iterator cell = cells_.find(getCellKey(x, y, z));
+					if(cell == cells_.end()) continue;
+					std::vector<uint32_t>& ids = cell->second;
+					std::vector<uint32_t>::iterator found = std::find(ids.begin(), ids.end(), id);
+					if(found != ids.end()) {
+						*found = ids.back();
+						ids.pop_back();
+					}
+					if(ids.empty()) cells_.erase(cell);
+				}
+			}
+		}
+	}
+	triangle_count_ -= instance.shape->getTriangleCount();
+	instance.shape.reset();
+	free_instances_.push_back(id);
+	owners_.erase(it);
+}
+
+// Earliest t in [0, limit] where a t^2 + b t + c crosses zero from above.
+// A negative c means the sphere already overlaps, which only counts as a
+// contact at zero while it moves further in.
+static bool getEntryTime(float a, float b, float c, float limit, float& time) {
+	if(c < 0.0f) {
+		if(b >= 0.0f) return false;
+		time = 0.0f;
+		return true;
+	}
+	if(a < 1e-12f) return false;
+	float discriminant = b * b - 4.0f * a * c;
+	if(discriminant < 0.0f) return false;
+	float t = (-b - sqrtf(discriminant)) / (2.0f * a);
+	if(t < 0.0f || t > limit) return false;
+	time = t;
+	return true;
+}
+
+// Lowers best to the first touch of the sphere on the triangle before it
+static bool sweepTriangle(const glm::vec3 corners[3], const glm::vec3& position, float radius, const glm::vec3& motion,
+						  float motion_squared, float& best, glm::vec3& contact) {
+	const glm::vec3& a = corners[0];
+	const glm::vec3& b = corners[1];
+	const glm::vec3& c = corners[2];
+	glm::vec3 n = glm::cross(b - a, c - a);
+	float length = glm::length(n);
+	if(length < 1e-12f) return false;
+	n /= length;
+
+	// Face: the sphere meets the plane inside the triangle. The plane normal
+	// is flipped to the sphere's side, so both faces collide.
+	glm::vec3 plane_normal = n;
+	float distance = glm::dot(plane_normal, position - a);
+	if(distance < 0.0f) {
+		plane_normal = -plane_normal;
+		distance = -distance;
+	}
+	float approach = glm::dot(plane_normal, motion);
+	if(distance >= radius + (approach < 0.0f ? -approach : 0.0f)) return false;
+
+	if(approach < 0.0f) {
+		float t = distance > radius ? (distance - radius) / -approach : 0.0f;
+		if(t < best) {
+			glm::vec3 point = distance > radius ? position + t * motion - radius * plane_normal
+												: position - distance * plane_normal;
+			bool inside = glm::dot(glm::cross(b - a, point - a), n) >= 0.0f &&
+						  glm::dot(glm::cross(c - b, point - b), n) >= 0.0f &&
+						  glm::dot(glm::cross(a - c, point - c), n) >= 0.0f;
+			if(inside) {
+				best = t;
+				contact = point;
+				return true;
+			}
+		}
+	}
+
+	// Otherwise the first touch is on an edge or a corner
+	bool hit = false;
+	for(int corner = 0; corner < 3; corner++) {
+		const glm::vec3& v = corners[corner];
+		glm::vec3 offset = position - v;
+		float t;
+		if(getEntryTime(motion_squared, 2.0f * glm::dot(motion, offset), glm::dot(offset, offset) - radius * radius,
+						best, t)) {
+			hit = true;
+			best = t;
+			contact = v;
+		}
+
+		const glm::vec3& next = corners[(corner + 1) % 3];
+		glm::vec3 edge = next - v;
+		glm::vec3 base = v - position;
+		float edge_squared = glm::dot(edge, edge);
+		float edge_motion = glm::dot(edge, motion);
+		float edge_base = glm::dot(edge, base);
+		float qa = edge_squared * motion_squared - edge_motion * edge_motion;
+		float qb = -2.0f * edge_squared * glm::dot(motion, base) + 2.0f * edge_motion * edge_base;
+		float qc = edge_squared * (glm::dot(base, base) - radius * radius) - edge_base * edge_base;
+		if(!getEntryTime(qa, qb, qc, best, t)) continue;
+		float along = (t * edge_motion - edge_base) / edge_squared;
+		if(along < 0.0f || along > 1.0f) continue;
+		hit = true;
+		best = t;
+		contact = v + along * edge;
+	}
+	return hit;
+}
+
+void CollisionWorld::sweepInstance(Instance& instance, const glm::vec3& position, float radius,
+								   const glm::vec3& motion, const glm::vec3& sweep_min, const glm::vec3& sweep_max,
+								   float& best, glm::vec3& contact, bool& hit) {
+	for(int axis = 0; axis < 3; axis++)
+		if(sweep_min[axis] > instance.bounds_max[axis] || sweep_max[axis] < instance.bounds_min[axis]) return;
+
+	// Candidates come from the shape's grid with the sweep box taken into
+	// the shape's space, the tests run on the triangles taken into the world,
+	// so scaled placements keep a round sphere
+	glm::vec3 local_min, local_max;
+	transformBounds(instance.inverse, sweep_min, sweep_max, local_min, local_max);
+	candidates_.clear();
+	instance.shape->query(local_min, local_max, candidates_);
+	std::sort(candidates_.begin(), candidates_.end());
+	candidates_.erase(std::unique(candidates_.begin(), candidates_.end()), candidates_.end());
+
+	float motion_squared = glm::dot(motion, motion);
+	for(size_t n = 0; n < candidates_.size(); n++) {
+		glm::vec3 corners[3];
+		instance.shape->getTriangle(candidates_[n], corners);
+		for(int corner = 0; corner < 3; corner++)
+			corners[corner] = glm::vec3(instance.transform * glm::vec4(corners[corner], 1.0f));
+		tested_++;
+		if(sweepTriangle(corners, position, radius, motion, motion_squared, best, contact)) hit = true;
+	}
+}
+
+bool CollisionWorld::sweepSphere(const glm::vec3& position, float radius, const glm::vec3& motion, float& time,
+								 glm::vec3& normal) {
+	// Placements under the box around the whole sweep
+	glm::vec3 end = position + motion;
+	glm::vec3 sweep_min = glm::min(position, end) - radius;
+	glm::vec3 sweep_max = glm::max(position, end) + radius;
+	int cell_min[3], cell_max[3];
+	getCell(sweep_min, cell_min);
+	getCell(sweep_max, cell_max);
+
+	if(++stamp_ == 0) {
+		std::fill(stamps_.begin(), stamps_.end(), 0);
+		stamp_ = 1;
+	}
+
+	bool hit = false;
+	float best = 1.0f;
+	glm::vec3 contact;
+	for(int z = cell_min[2]; z <= cell_max[2]; z++) {
+		for(int y = cell_min[1]; y <= cell_max[1]; y++) {
+			for(int x = cell_min[0]; x <= cell_max[0]; x++) {
+				std::unordered_map<uint64_t, std::vector<uint32_t>>::iterator cell = cells_.find(getCellKey(x, y, z));
+				if(cell == cells_.end()) continue;
+
+				const std::vector<uint32_t>& ids = cell->second;
+				for(size_t n = 0; n < ids.size(); n++) {
+					if(stamps_[ids[n]] == stamp_) continue;
+					stamps_[ids[n]] = stamp_;
+					sweepInstance(instances_[ids[n]], position, radius, motion, sweep_min, sweep_max, best, contact,
+								  hit);
+				}
+			}
+		}
+	}
+	for(size_t n = 0; n < overflow_.size(); n++)
+		sweepInstance(instances_[overflow_[n]], position, radius, motion, sweep_min, sweep_max, best, contact, hit);
+	if(!hit) return false;
+
+	time = best;
+	normal = position + best * motion - contact;
+	float length = glm::length(normal);
+	normal = length > 1e-6f ? normal / length : -motion / sqrtf(glm::dot(motion, motion));
+	return true;
+}
+
+glm::vec3 CollisionWorld::moveSphere(const glm::vec3& position, float radius, const glm::vec3& motion) {
+	glm::vec3 current = position;
+	glm::vec3 remaining = motion;
+	for(int slide = 0; slide < MAX_SLIDES; slide++) {
+		float length = glm::length(remaining);
+		if(length < COLLISION_SKIN) break;
+
+		float time;
+		glm::vec3 normal;
+		if(!sweepSphere(current, radius, remaining, time, normal)) {
+			current += remaining;
+			break;
+		}
+
+		// Up to the contact less the skin, then the rest along the surface
+		float travel = std::max(0.0f, time * length - COLLISION_SKIN);
+		current += remaining * (travel / length);
+		remaining = remaining * (1.0f - time);
+		float into = glm::dot(remaining, normal);
+		if(into < 0.0f) remaining -= into * normal;
+	}
+	return current;
+}
+
+int CollisionWorld::getTriangleCount() {
+	return triangle_count_;
+}
+
+size_t CollisionWorld::getTestedCount() {
+	return tested_;
+}
@@ -0,0 +1,62 @@
+#include <cstring>
+#include "CommandList.h"
+
+template<class T> void CommandList::write(CommandType type, const T& payload) {
+	CommandHeader header = { type, sizeof(T) };
+	size_t offset = data_.size();
+	data_.resize(offset + sizeof(header) + sizeof(T));
+	memcpy(&data_[offset], &header, sizeof(header));
+	memcpy(&data_[offset + sizeof(header)], &payload, sizeof(T));
+}
+
+void CommandList::clear() {
+	data_.clear();
+}
+
+void CommandList::bindProgram(uint32_t program) {
+	BindProgramCommand command = { program };
+	write(COMMAND_BIND_PROGRAM, command);
+}
+
+void CommandList::bindVertexArray(uint32_t vertex_array) {
+	BindVertexArrayCommand command = { vertex_array };
+	write(COMMAND_BIND_VERTEX_ARRAY, command);
+}
+
+void CommandList::setMatrix(int32_t location, const float* matrix) {
+	SetMatrixCommand command;
+	command.location = location;
+	memcpy(command.matrix, matrix, sizeof(command.matrix));
+	write(COMMAND_SET_MATRIX, command);
+}
+
+void CommandList::setVector(int32_t location, const float* vector) {
+	SetVectorCommand command;
+	command.location = location;
+	memcpy(command.vector, vector, sizeof(command.vector));
+	write(COMMAND_SET_VECTOR, command);
+}
+
+void CommandList::drawIndexed(int32_t index_count, uint32_t first_index, int32_t base_vertex) {
+	DrawIndexedCommand command = { index_count, first_index, base_vertex };
+	write(COMMAND_DRAW_INDEXED, command);
+}
+
+void CommandList::bindStorage(uint32_t binding, uint32_t buffer, int64_t offset, int64_t size) {
+	BindStorageCommand command = { binding, buffer, offset, size };
+	write(COMMAND_BIND_STORAGE, command);
+}
+
+void CommandList::multiDrawIndirect(uint32_t buffer, bool indexed, int64_t offset, int32_t draw_count,
+									int32_t triangle_count) {
+	MultiDrawIndirectCommand command = { buffer, indexed, offset, draw_count, triangle_count };
+	write(COMMAND_MULTI_DRAW_INDIRECT, command);
+}
+
+const uint8_t* CommandList::begin() const {
+	return data_.data();
+}
+
+const uint8_t* CommandList::end() const {
+	return data_.data() + data_.size();
+}
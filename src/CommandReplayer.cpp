@@ -0,0 +1,102 @@
+#include <cstring>
+#include "CommandReplayer.h"
+#include "GLStateCache.h"
+
+CommandReplayer::CommandReplayer()
+	: program_(0), draw_count_(0), triangle_count_(0), skipped_count_(0) {}
+
+void CommandReplayer::beginFrame() {
+	// Other code sets uniforms between frames, so no values carry over
+	program_ = 0;
+	matrices_.clear();
+	draw_count_ = 0;
+	triangle_count_ = 0;
+	skipped_count_ = 0;
+}
+
+void CommandReplayer::replay(const CommandList& list) {
+	const uint8_t* cursor = list.begin();
+	while(cursor < list.end()) {
+		CommandHeader header;
+		memcpy(&header, cursor, sizeof(header));
+		const uint8_t* payload = cursor + sizeof(header);
+		cursor = payload + header.size;
+
+		switch(header.type) {
+			case COMMAND_BIND_PROGRAM: {
+				BindProgramCommand command;
+				memcpy(&command, payload, sizeof(command));
+				gl_state.useProgram(command.program);
+				if(command.program != program_) matrices_.clear();
+				program_ = command.program;
+				break;
+			}
+			case COMMAND_BIND_VERTEX_ARRAY: {
+				BindVertexArrayCommand command;
+				memcpy(&command, payload, sizeof(command));
+				gl_state.bindVertexArray(command.vertex_array);
+				break;
+			}
+			case COMMAND_SET_MATRIX: {
+				SetMatrixCommand command;
+				memcpy(&command, payload, sizeof(command));
+				std::map<GLint, Matrix>::iterator current = matrices_.find(command.location);
+				if(current != matrices_.end() && memcmp(current->second.values, command.matrix, sizeof(command.matrix)) == 0) {
+					skipped_count_++;
+					break;
+				}
+				glUniformMatrix4fv(command.location, 1, GL_FALSE, command.matrix);
+				memcpy(matrices_[command.location].values, command.matrix, sizeof(command.matrix));
+				break;
+			}
+			case COMMAND_SET_VECTOR: {
+				SetVectorCommand command;
+				memcpy(&command, payload, sizeof(command));
+				glUniform3fv(command.location, 1, command.vector);
+				break;
+			}
+			case COMMAND_DRAW_INDEXED: {
+				DrawIndexedCommand command;
+				memcpy(&command, payload, sizeof(command));
+				glDrawElementsBaseVertex(GL_TRIANGLES, command.index_count, GL_UNSIGNED_INT,
+										 (void*)(command.first_index * sizeof(unsigned int)), command.base_vertex);
+				draw_count_++;
+				triangle_count_ += command.index_count / 3;
+				break;
+			}
+			case COMMAND_BIND_STORAGE: {
+				BindStorageCommand command;
+				memcpy(&command, payload, sizeof(command));
+				gl_state.bindBufferRange(GL_SHADER_STORAGE_BUFFER, command.binding, command.buffer,
+										 command.offset, command.size);
+				break;
+			}
+			case COMMAND_MULTI_DRAW_INDIRECT: {
+				MultiDrawIndirectCommand command;
+				memcpy(&command, payload, sizeof(command));
+				gl_state.bindBuffer(GL_DRAW_INDIRECT_BUFFER, command.buffer);
+				if(command.indexed) {
+					glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)command.offset,
+												command.draw_count, 0);
+				} else {
+					glMultiDrawArraysIndirect(GL_TRIANGLES, (void*)command.offset, command.draw_count, 0);
+				}
+				draw_count_++;
+				triangle_count_ += command.triangle_count;
+				break;
+			}
+		}
+	}
+}
+
+int CommandReplayer::getDrawCount() {
+	return draw_count_;
+}
+
+int CommandReplayer::getTriangleCount() {
+	return triangle_count_;
+}
+
+int CommandReplayer::getSkippedCount() {
+	return skipped_count_;
+}
@@ -0,0 +1,199 @@
+#include <cmath>
+#include "EntityStore.h"
+#include "TransformKernels.h"
+
+template<typename T> static void swapRemove(std::vector<T>& values, int index) {
+	values[index] = values.back();
+	values.pop_back();
+}
+
+EntityStore::EntityStore() {}
+
+EntityHandle EntityStore::create(MeshHandle mesh, const Prism& prism, uint32_t material, uint32_t group) {
+	uint32_t slot;
+	if(!free_slots_.empty()) {
+		slot = free_slots_.back();
+		free_slots_.pop_back();
+	} else {
+		if(slot_to_dense_.size() >= ENTITY_MAX_COUNT) return INVALID_ENTITY;
+		slot = slot_to_dense_.size();
+		slot_to_dense_.push_back(0);
+		generations_.push_back(0);
+	}
+	EntityHandle entity = slot | ((EntityHandle)generations_[slot] << ENTITY_INDEX_BITS);
+	slot_to_dense_[slot] = dense_to_handle_.size();
+	dense_to_handle_.push_back(entity);
+
+	// Identity transform and empty bounds until set
+	position_x_.push_back(0.0f);
+	position_y_.push_back(0.0f);
+	position_z_.push_back(0.0f);
+	rotation_x_.push_back(0.0f);
+	rotation_y_.push_back(0.0f);
+	rotation_z_.push_back(0.0f);
+	rotation_w_.push_back(1.0f);
+	scale_x_.push_back(1.0f);
+	scale_y_.push_back(1.0f);
+	scale_z_.push_back(1.0f);
+	local_min_.push_back(glm::vec3(0.0f));
+	local_max_.push_back(glm::vec3(0.0f));
+	parents_.push_back(INVALID_SCENE_NODE);
+	world_.push_back(glm::mat4(1.0f));
+	world_min_.push_back(glm::vec3(0.0f));
+	world_max_.push_back(glm::vec3(0.0f));
+	meshes_.push_back(mesh);
+	materials_.push_back(material);
+	groups_.push_back(group);
+	prisms_.push_back(prism);
+	return entity;
+}
+
+void EntityStore::destroy(EntityHandle entity) {
+	if(!isAlive(entity)) return;
+	uint32_t slot = (uint32_t)entity;
+	int index = slot_to_dense_[slot];
+
+	// The last entity moves into the hole, its slot follows it
+	EntityHandle moved = dense_to_handle_.back();
+	slot_to_dense_[(uint32_t)moved] = index;
+	swapRemove(dense_to_handle_, index);
+	swapRemove(position_x_, index);
+	swapRemove(position_y_, index);
+	swapRemove(position_z_, index);
+	swapRemove(rotation_x_, index);
+	swapRemove(rotation_y_, index);
+	swapRemove(rotation_z_, index);
+	swapRemove(rotation_w_, index);
+	swapRemove(scale_x_, index);
+	swapRemove(scale_y_, index);
+	swapRemove(scale_z_, index);
+	swapRemove(local_min_, index);
+	swapRemove(local_max_, index);
+	swapRemove(parents_, index);
+	swapRemove(world_, index);
+	swapRemove(world_min_, index);
+	swapRemove(world_max_, index);
+	swapRemove(meshes_, index);
+	swapRemove(materials_, index);
+	swapRemove(groups_, index);
+	swapRemove(prisms_, index);
+
+	generations_[slot]++;
+	free_slots_.push_back(slot);
+}
+
+bool EntityStore::isAlive(EntityHandle entity) {
+	uint32_t slot = (uint32_t)entity;
+	return entity != INVALID_ENTITY && slot < generations_.size() &&
+		   generations_[slot] == entity >> ENTITY_INDEX_BITS;
+}
+
+int EntityStore::getIndex(EntityHandle entity) {
+	return isAlive(entity) ? (int)slot_to_dense_[(uint32_t)entity] : -1;
+}
+
+EntityHandle EntityStore::getHandle(int index) {
+	return dense_to_handle_[index];
+}
+
+int EntityStore::getCount() {
+	return dense_to_handle_.size();
+}
+
+void EntityStore::setTransform(EntityHandle entity, const glm::vec3& position, const glm::quat& rotation,
+							   const glm::vec3& scale) {
+	int index = getIndex(entity);
+	if(index < 0) return;
+	position_x_[index] = position.x;
+	position_y_[index] = position.y;
+	position_z_[index] = position.z;
+	rotation_x_[index] = rotation.x;
+	rotation_y_[index] = rotation.y;
+	rotation_z_[index] = rotation.z;
+	rotation_w_[index] = rotation.w;
+	scale_x_[index] = scale.x;
+	scale_y_[index] = scale.y;
+	scale_z_[index] = scale.z;
+}
+
+void EntityStore::setTransform(EntityHandle entity, const glm::mat4& transform) {
+	// Split into translation, rotation and scale, assuming no shear. A
+	// mirroring transform keeps its handedness in a negative x scale.
+	glm::vec3 axes[3] = { glm::vec3(transform[0]), glm::vec3(transform[1]), glm::vec3(transform[2]) };
+	glm::vec3 scale(glm::length(axes[0]), glm::length(axes[1]), glm::length(axes[2]));
+	if(glm::dot(glm::cross(axes[0], axes[1]), axes[2]) < 0.0f) scale.x = -scale.x;
+
+	glm::mat3 rotation(1.0f);
+	for(int axis = 0; axis < 3; axis++)
+		if(scale[axis] != 0.0f) rotation[axis] = axes[axis] / scale[axis];
+	setTransform(entity, glm::vec3(transform[3]), glm::quat_cast(rotation), scale);
+}
+
+void EntityStore::setBounds(EntityHandle entity, const glm::vec3& local_min, const glm::vec3& local_max) {
+	int index = getIndex(entity);
+	if(index < 0) return;
+	local_min_[index] = local_min;
+	local_max_[index] = local_max;
+}
+
+void EntityStore::setParent(EntityHandle entity, SceneNode node) {
+	int index = getIndex(entity);
+	if(index < 0) return;
+	parents_[index] = node;
+}
+
+void EntityStore::updateTransforms(SceneGraph& graph, int begin, int end) {
+	// All matrices of the range in one batched call, on the widest SIMD
+	// kernel the CPU has, before the per-entity pass below
+	TransformArrays transforms = { position_x_.data(), position_y_.data(), position_z_.data(),
+								   rotation_x_.data(), rotation_y_.data(), rotation_z_.data(), rotation_w_.data(),
+								   scale_x_.data(), scale_y_.data(), scale_z_.data() };
+	composeTransforms(transforms, begin, end, world_.data());
+
+	// Parents and bounds read each matrix while it is still in cache
+	for(int i = begin; i < end; i++) {
+		if(parents_[i] != INVALID_SCENE_NODE) world_[i] = graph.getWorldTransform(parents_[i]) * world_[i];
+		const float* m = &world_[i][0][0];
+
+		// World box around the transformed local box: the center is
+		// transformed, the half extent is spread by the absolute axes
+		const glm::vec3& low = local_min_[i];
+		const glm::vec3& high = local_max_[i];
+		float center[3] = { (low.x + high.x) * 0.5f, (low.y + high.y) * 0.5f, (low.z + high.z) * 0.5f };
+		float extent[3] = { (high.x - low.x) * 0.5f, (high.y - low.y) * 0.5f, (high.z - low.z) * 0.5f };
+		for(int row = 0; row < 3; row++) {
+			float c = m[12 + row] + m[row] * center[0] + m[4 + row] * center[1] + m[8 + row] * center[2];
+			float e = fabsf(m[row]) * extent[0] + fabsf(m[4 + row]) * extent[1] + fabsf(m[8 + row]) * extent[2];
+			world_min_[i][row] = c - e;
+			world_max_[i][row] = c + e;
+		}
+	}
+}
+
+const glm::mat4* EntityStore::getWorldMatrices() {
+	return world_.data();
+}
+
+const glm::vec3* EntityStore::getWorldBoundsMin() {
+	return world_min_.data();
+}
+
+const glm::vec3* EntityStore::getWorldBoundsMax() {
+	return world_max_.data();
+}
+
+const MeshHandle* EntityStore::getMeshes() {
+	return meshes_.data();
+}
+
+const uint32_t* EntityStore::getMaterials() {
+	return materials_.data();
+}
+
+const uint32_t* EntityStore::getGroups() {
+	return groups_.data();
+}
+
+Prism& EntityStore::getPrism(int index) {
+	return prisms_[index];
+}
@@ -0,0 +1,50 @@
+#include "FramePipeline.h"
+
+FramePipeline::FramePipeline(int latency_budget)
+	: slots_(latency_budget < 1 ? 2 : latency_budget + 1), write_(0), read_(0), filled_(0),
+	  frame_(0), stopped_(false) {}
+
+FrameSnapshot* FramePipeline::beginWrite() {
+	// Wait for a slot that is neither queued nor being rendered
+	std::unique_lock<std::mutex> lock(mutex_);
+	changed_.wait(lock, [this]() { return filled_ < (int)slots_.size() || stopped_; });
+	if(stopped_) return nullptr;
+
+	FrameSnapshot* snapshot = &slots_[write_];
+	snapshot->frame = frame_++;
+	return snapshot;
+}
+
+void FramePipeline::publish() {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		write_ = (write_ + 1) % slots_.size();
+		filled_++;
+	}
+	changed_.notify_all();
+}
+
+const FrameSnapshot* FramePipeline::acquire() {
+	std::unique_lock<std::mutex> lock(mutex_);
+	changed_.wait(lock, [this]() { return filled_ > 0 || stopped_; });
+	if(stopped_) return nullptr;
+
+	return &slots_[read_];
+}
+
+void FramePipeline::release() {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		read_ = (read_ + 1) % slots_.size();
+		filled_--;
+	}
+	changed_.notify_all();
+}
+
+void FramePipeline::stop() {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stopped_ = true;
+	}
+	changed_.notify_all();
+}
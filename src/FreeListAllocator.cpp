@@ -0,0 +1,75 @@
+#include "FreeListAllocator.h"
+
+FreeListAllocator::FreeListAllocator(long capacity)
+	: capacity_(capacity), free_size_(capacity) {
+	if(capacity > 0) free_blocks_[0] = capacity;
+}
+
+static long alignOffset(long offset, long alignment) {
+	return (offset + alignment - 1) / alignment * alignment;
+}
+
+long FreeListAllocator::allocate(long size, long alignment) {
+	for(std::map<long, long>::iterator it = free_blocks_.begin(); it != free_blocks_.end(); ++it) {
+		long block_offset = it->first;
+		long offset = alignOffset(block_offset, alignment);
+		if(offset + size > block_offset + it->second) continue;
+
+		// Padding in front of an aligned allocation stays a free block
+		long remaining = block_offset + it->second - offset - size;
+		free_blocks_.erase(it);
+		if(offset > block_offset) free_blocks_[block_offset] = offset - block_offset;
+		if(remaining > 0) free_blocks_[offset + size] = remaining;
+		free_size_ -= size;
+		return offset;
+	}
+	return INVALID_OFFSET;
+}
+
+void FreeListAllocator::release(long offset, long size) {
+	free_size_ += size;
+	std::map<long, long>::iterator next = free_blocks_.lower_bound(offset);
+
+	// Merge with the following block
+	if(next != free_blocks_.end() && offset + size == next->first) {
+		size += next->second;
+		next = free_blocks_.erase(next);
+	}
+
+	// Merge with the preceding block
+	if(next != free_blocks_.begin()) {
+		std::map<long, long>::iterator prev = next;
+		--prev;
+		if(prev->first + prev->second == offset) {
+			prev->second += size;
+			return;
+		}
+	}
+
+	free_blocks_[offset] = size;
+}
+
+long FreeListAllocator::findHole(long size, long below, long alignment) {
+	// First free block that fits and ends before the given offset
+	for(std::map<long, long>::iterator it = free_blocks_.begin(); it != free_blocks_.end(); ++it) {
+		long offset = alignOffset(it->first, alignment);
+		if(it->first + size > below) break;
+		if(offset + size <= below && offset + size <= it->first + it->second) return offset;
+	}
+	return INVALID_OFFSET;
+}
+
+bool FreeListAllocator::isCompact() {
+	// At most one free block, and it runs to the end
+	if(free_blocks_.empty()) return true;
+	if(free_blocks_.size() > 1) return false;
+	return free_blocks_.begin()->first + free_blocks_.begin()->second == capacity_;
+}
+
+long FreeListAllocator::getCapacity() {
+	return capacity_;
+}
+
+long FreeListAllocator::getFreeSize() {
+	return free_size_;
+}
@@ -0,0 +1,88 @@
+#include <SDL3/SDL.h>
+#include <glad/glad.h>
+#include <iostream>
+#include "GLDebug.h"
+
+#ifdef D3_DEBUG
+// Only written and read on the render thread, since debug builds use
+// synchronous output and the callback runs inside the offending GL call.
+static const char* debug_file = "?";
+static int debug_line = 0;
+static const char* debug_function = "?";
+
+void markDebugLocation(const char* file, int line, const char* function) {
+	debug_file = file;
+	debug_line = line;
+	debug_function = function;
+}
+#endif
+
+static const char* debugSourceName(GLenum source) {
+	switch(source) {
+		case GL_DEBUG_SOURCE_API: return "API";
+		case GL_DEBUG_SOURCE_WINDOW_SYSTEM: return "window system";
+		case GL_DEBUG_SOURCE_SHADER_COMPILER: return "shader compiler";
+		case GL_DEBUG_SOURCE_THIRD_PARTY: return "third party";
+		case GL_DEBUG_SOURCE_APPLICATION: return "application";
+		default: return "other";
+	}
+}
+
+static const char* debugTypeName(GLenum type) {
+	switch(type) {
+		case GL_DEBUG_TYPE_ERROR: return "error";
+		case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return "deprecated";
+		case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR: return "undefined behavior";
+		case GL_DEBUG_TYPE_PORTABILITY: return "portability";
+		case GL_DEBUG_TYPE_PERFORMANCE: return "performance";
+		default: return "other";
+	}
+}
+
+static const char* debugSeverityName(GLenum severity) {
+	switch(severity) {
+		case GL_DEBUG_SEVERITY_HIGH: return "high";
+		case GL_DEBUG_SEVERITY_MEDIUM: return "medium";
+		case GL_DEBUG_SEVERITY_LOW: return "low";
+		default: return "notification";
+	}
+}
+
+static void APIENTRY debugCallback(GLenum source, GLenum type, GLuint id, GLenum severity,
+								   GLsizei length, const GLchar* message, const void* userParam) {
+	std::cerr << "OpenGL " << debugTypeName(type)
+			  << " [" << debugSourceName(source) << ", " << debugSeverityName(severity) << ", " << id << "]: "
+			  << message << std::endl;
+#ifdef D3_DEBUG
+	std::cerr << "    near " << debug_file << ":" << debug_line << " (" << debug_function << ")" << std::endl;
+#endif
+}
+
+void requestDebugContext() {
+#ifdef D3_DEBUG
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_DEBUG_FLAG);
+#endif
+}
+
+void initializeDebugOutput() {
+	// glDebugMessageCallback is core since 4.3
+	if(!GLAD_GL_VERSION_4_3) {
+		std::cerr << "GL_KHR_debug unavailable, OpenGL errors will not be reported" << std::endl;
+		return;
+	}
+
+	glEnable(GL_DEBUG_OUTPUT);
+	glDebugMessageCallback(debugCallback, nullptr);
+
+#ifdef D3_DEBUG
+	// Deliver messages inside the failing call so the marked location is accurate
+	glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+	glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, GL_TRUE);
+	glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, nullptr, GL_FALSE);
+#else
+	// Let the driver report from its own thread and only for real errors
+	glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+	glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, GL_FALSE);
+	glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_HIGH, 0, nullptr, GL_TRUE);
+#endif
+}
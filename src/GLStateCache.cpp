@@ -0,0 +1,177 @@
+#include "GLStateCache.h"
+
+GLStateCache gl_state;
+
+static const GLenum buffer_targets[] = {
+	GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER, GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+	GL_SHADER_STORAGE_BUFFER, GL_DRAW_INDIRECT_BUFFER, GL_UNIFORM_BUFFER, GL_PIXEL_UNPACK_BUFFER
+};
+
+GLStateCache::GLStateCache()
+	: issued_count_(0), suppressed_count_(0), program_bind_count_(0), vertex_array_bind_count_(0) {
+	invalidate();
+}
+
+void GLStateCache::invalidate() {
+	program_ = UNKNOWN;
+	vertex_array_ = UNKNOWN;
+	for(int i = 0; i < BUFFER_TARGET_COUNT; i++)
+		buffers_[i] = UNKNOWN;
+	for(int i = 0; i < STORAGE_BINDING_COUNT; i++)
+		storage_buffers_[i].buffer = UNKNOWN;
+	polygon_mode_ = UNKNOWN;
+	blend_ = UNKNOWN;
+	blend_source_ = UNKNOWN;
+	blend_destination_ = UNKNOWN;
+	depth_test_ = UNKNOWN;
+	depth_mask_ = UNKNOWN;
+	clear_color_known_ = false;
+}
+
+void GLStateCache::forgetBuffer(GLuint buffer) {
+	for(int i = 0; i < BUFFER_TARGET_COUNT; i++)
+		if(buffers_[i] == buffer) buffers_[i] = UNKNOWN;
+	for(int i = 0; i < STORAGE_BINDING_COUNT; i++)
+		if(storage_buffers_[i].buffer == buffer) storage_buffers_[i].buffer = UNKNOWN;
+}
+
+void GLStateCache::forgetVertexArray(GLuint vertex_array) {
+	if(vertex_array != vertex_array_) return;
+	vertex_array_ = UNKNOWN;
+	buffers_[bufferTargetIndex(GL_ELEMENT_ARRAY_BUFFER)] = UNKNOWN;
+}
+
+bool GLStateCache::changed(bool differs) {
+	if(differs) issued_count_++;
+	else suppressed_count_++;
+	return differs;
+}
+
+int GLStateCache::bufferTargetIndex(GLenum target) {
+	for(int i = 0; i < BUFFER_TARGET_COUNT; i++)
+		if(buffer_targets[i] == target) return i;
+	return -1;
+}
+
+void GLStateCache::useProgram(GLuint program) {
+	if(!changed(program != program_)) return;
+	glUseProgram(program);
+	program_ = program;
+	program_bind_count_++;
+}
+
+void GLStateCache::bindVertexArray(GLuint vertex_array) {
+	if(!changed(vertex_array != vertex_array_)) return;
+	glBindVertexArray(vertex_array);
+	vertex_array_ = vertex_array;
+	vertex_array_bind_count_++;
+
+	// The element buffer binding belongs to the vertex array
+	buffers_[bufferTargetIndex(GL_ELEMENT_ARRAY_BUFFER)] = UNKNOWN;
+}
+
+void GLStateCache::bindBuffer(GLenum target, GLuint buffer) {
+	int index = bufferTargetIndex(target);
+	if(index < 0) {
+		glBindBuffer(target, buffer);
+		issued_count_++;
+		return;
+	}
+
+	if(!changed(buffer != buffers_[index])) return;
+	glBindBuffer(target, buffer);
+	buffers_[index] = buffer;
+}
+
+void GLStateCache::bindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+	bindBufferRange(target, index, buffer, 0, 0);
+}
+
+void GLStateCache::bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+	// Only shader storage bindings are tracked
+	bool tracked = target == GL_SHADER_STORAGE_BUFFER && index < (GLuint)STORAGE_BINDING_COUNT;
+	if(tracked) {
+		IndexedBinding& binding = storage_buffers_[index];
+		if(!changed(buffer != binding.buffer || offset != binding.offset || size != binding.size)) return;
+		binding.buffer = buffer;
+		binding.offset = offset;
+		binding.size = size;
+	} else {
+		issued_count_++;
+	}
+
+	if(size == 0) glBindBufferBase(target, index, buffer);
+	else glBindBufferRange(target, index, buffer, offset, size);
+
+	// Indexed binds also replace the generic binding of the target
+	int generic = bufferTargetIndex(target);
+	if(generic >= 0) buffers_[generic] = buffer;
+}
+
+void GLStateCache::polygonMode(GLenum mode) {
+	if(!changed(mode != polygon_mode_)) return;
+	glPolygonMode(GL_FRONT_AND_BACK, mode);
+	polygon_mode_ = mode;
+}
+
+void GLStateCache::setBlend(bool enabled) {
+	if(!changed((GLuint)enabled != blend_)) return;
+	if(enabled) glEnable(GL_BLEND);
+	else glDisable(GL_BLEND);
+	blend_ = enabled;
+}
+
+void GLStateCache::blendFunc(GLenum source, GLenum destination) {
+	if(!changed(source != blend_source_ || destination != blend_destination_)) return;
+	glBlendFunc(source, destination);
+	blend_source_ = source;
+	blend_destination_ = destination;
+}
+
+void GLStateCache::setDepthTest(bool enabled) {
+	if(!changed((GLuint)enabled != depth_test_)) return;
+	if(enabled) glEnable(GL_DEPTH_TEST);
+	else glDisable(GL_DEPTH_TEST);
+	depth_test_ = enabled;
+}
+
+void GLStateCache::depthMask(bool enabled) {
+	if(!changed((GLuint)enabled != depth_mask_)) return;
+	glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+	depth_mask_ = enabled;
+}
+
+void GLStateCache::clearColor(float r, float g, float b, float a) {
+	bool differs = !clear_color_known_ || r != clear_color_[0] || g != clear_color_[1] ||
+				   b != clear_color_[2] || a != clear_color_[3];
+	if(!changed(differs)) return;
+	glClearColor(r, g, b, a);
+	clear_color_[0] = r;
+	clear_color_[1] = g;
+	clear_color_[2] = b;
+	clear_color_[3] = a;
+	clear_color_known_ = true;
+}
+
+void GLStateCache::resetCounters() {
+	issued_count_ = 0;
+	suppressed_count_ = 0;
+	program_bind_count_ = 0;
+	vertex_array_bind_count_ = 0;
+}
+
+int GLStateCache::getIssuedCount() {
+	return issued_count_;
+}
+
+int GLStateCache::getSuppressedCount() {
+	return suppressed_count_;
+}
+
+int GLStateCache::getProgramBindCount() {
+	return program_bind_count_;
+}
+
+int GLStateCache::getVertexArrayBindCount() {
+	return vertex_array_bind_count_;
+}
@@ -0,0 +1,814 @@
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <utility>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "GltfFile.h"
+
+#define GLB_MAGIC 0x46546C67
+#define GLB_CHUNK_JSON 0x4E4F534A
+#define GLB_CHUNK_BIN 0x004E4942
+#define JSON_MAX_DEPTH 64
+
+enum GltfComponentType {
+	GLTF_BYTE = 5120,
+	GLTF_UNSIGNED_BYTE = 5121,
+	GLTF_SHORT = 5122,
+	GLTF_UNSIGNED_SHORT = 5123,
+	GLTF_UNSIGNED_INT = 5125,
+	GLTF_FLOAT = 5126
+};
+
+enum GltfMode {
+	GLTF_TRIANGLES = 4,
+	GLTF_TRIANGLE_STRIP = 5,
+	GLTF_TRIANGLE_FAN = 6
+};
+
+enum JsonType { JSON_NULL, JSON_BOOL, JSON_NUMBER, JSON_STRING, JSON_ARRAY, JSON_OBJECT };
+
+// Parsed JSON document. Objects keep their keys next to the items, glTF
+// objects are small enough that a linear lookup is fine.
+struct JsonValue {
+	JsonType type = JSON_NULL;
+	double number = 0.0;
+	std::string string;
+	std::vector<std::string> keys;
+	std::vector<JsonValue> items;
+
+	const JsonValue* find(const char* key) const {
+		if(type != JSON_OBJECT) return nullptr;
+		for(size_t i = 0; i < keys.size(); i++)
+			if(keys[i] == key) return &items[i];
+		return nullptr;
+	}
+
+	const JsonValue* at(int index) const {
+		if(type != JSON_ARRAY || index < 0 || index >= (int)items.size()) return nullptr;
+		return &items[index];
+	}
+};
+
+// Elements of an accessor, bounds checked against their buffer view
+struct GltfAccessor {
+	const uint8_t* data;
+	size_t count;
+	size_t stride;
+	int component_type;
+	int components;
+	bool normalized;
+};
+
+static void skipWhitespace(const char*& cursor, const char* end) {
+	while(cursor < end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\n' || *cursor == '\r')) cursor++;
+}
+
+static void appendUtf8(std::string& out, uint32_t code) {
+	if(code < 0x80) {
+		out += (char)code;
+	} else if(code < 0x800) {
+		out += (char)(0xC0 | (code >> 6));
+		out += (char)(0x80 | (code & 0x3F));
+	} else if(code < 0x10000) {
+		out += (char)(0xE0 | (code >> 12));
+		out += (char)(0x80 | ((code >> 6) & 0x3F));
+		out += (char)(0x80 | (code & 0x3F));
+	} else {
+		out += (char)(0xF0 | (code >> 18));
+		out += (char)(0x80 | ((code >> 12) & 0x3F));
+		out += (char)(0x80 | ((code >> 6) & 0x3F));
+		out += (char)(0x80 | (code & 0x3F));
+	}
+}
+
+static bool parseHex4(const char*& cursor, const char* end, uint32_t& code) {
+	if(end - cursor < 4) return false;
+	code = 0;
+	for(int i = 0; i < 4; i++) {
+		char c = *cursor++;
+		code <<= 4;
+		if(c >= '0' && c <= '9') code |= c - '0';
+		else if(c >= 'a' && c <= 'f') code |= c - 'a' + 10;
+		else if(c >= 'A' && c <= 'F') code |= c - 'A' + 10;
+		else return false;
+	}
+	return true;
+}
+
+static bool parseString(const char*& cursor, const char* end, std::string& out) {
+	// Cursor is on the opening quote
+	cursor++;
+	while(cursor < end && *cursor != '"') {
+		char c = *cursor++;
+		if(c != '\\') {
+			out += c;
+			continue;
+		}
+		if(cursor == end) return false;
+		char escape = *cursor++;
+		switch(escape) {
+			case '"': out += '"'; break;
+			case '\\': out += '\\'; break;
+			case '/': out += '/'; break;
+			case 'b': out += '\b'; break;
+			case 'f': out += '\f'; break;
+			case 'n': out += '\n'; break;
+			case 'r': out += '\r'; break;
+			case 't': out += '\t'; break;
+			case 'u': {
+				uint32_t code;
+				if(!parseHex4(cursor, end, code)) return false;
+				// Surrogate pairs encode code points above the basic plane
+				if(code >= 0xD800 && code < 0xDC00 && end - cursor >= 6 && cursor[0] == '\\' && cursor[1] == 'u') {
+					cursor += 2;
+					uint32_t low;
+					if(!parseHex4(cursor, end, low) || low < 0xDC00 || low >= 0xE000) return false;
+					code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+				}
+				appendUtf8(out, code);
+				break;
+			}
+			default:
+				return false;
+		}
+	}
+	if(cursor == end) return false;
+	cursor++;
+	return true;
+}
+
+static bool parseNumber(const char*& cursor, const char* end, double& number) {
+	// The JSON chunk of a GLB is not terminated, so strtod gets a copy
+	char token[64];
+	size_t length = 0;
+	while(cursor < end && length < sizeof(token) - 1 && (memchr("+-.eE", *cursor, 5) || (*cursor >= '0' && *cursor <= '9')))
+		token[length++] = *cursor++;
+	token[length] = '\0';
+
+	char* parsed;
+	number = strtod(token, &parsed);
+	return length > 0 && parsed == token + length;
+}
+
+static bool parseValue(const char*& cursor, const char* end, JsonValue& value, int depth) {
+	skipWhitespace(cursor, end);
+	if(cursor == end || depth > JSON_MAX_DEPTH) return false;
+
+	if(*cursor == '{') {
+		value.type = JSON_OBJECT;
+		cursor++;
+		skipWhitespace(cursor, end);
+		if(cursor < end && *cursor == '}') {
+			cursor++;
+			return true;
+		}
+		while(true) {
+			skipWhitespace(cursor, end);
+			if(cursor == end || *cursor != '"') return false;
+			value.keys.emplace_back();
+			if(!parseString(cursor, end, value.keys.back())) return false;
+			skipWhitespace(cursor, end);
+			if(cursor == end || *cursor != ':') return false;
+			cursor++;
+			value.items.emplace_back();
+			if(!parseValue(cursor, end, value.items.back(), depth + 1)) return false;
+			skipWhitespace(cursor, end);
+			if(cursor == end) return false;
+			if(*cursor == '}') break;
+			if(*cursor++ != ',') return false;
+		}
+		cursor++;
+		return true;
+	}
+
+	if(*cursor == '[') {
+		value.type = JSON_ARRAY;
+		cursor++;
+		skipWhitespace(cursor, end);
+		if(cursor < end && *cursor == ']') {
+			cursor++;
+			return true;
+		}
+		while(true) {
+			value.items.emplace_back();
+			if(!parseValue(cursor, end, value.items.back(), depth + 1)) return false;
+			skipWhitespace(cursor, end);
+			if(cursor == end) return false;
+			if(*cursor == ']') break;
+			if(*cursor++ != ',') return false;
+		}
+		cursor++;
+		return true;
+	}
+
+	if(*cursor == '"') {
+		value.type = JSON_STRING;
+		return parseString(cursor, end, value.string);
+	}
+
+	const char* words[3] = { "true", "false", "null" };
+	for(int i = 0; i < 3; i++) {
+		size_t length = strlen(words[i]);
+		if((size_t)(end - cursor) >= length && memcmp(cursor, words[i], length) == 0) {
+			value.type = i < 2 ? JSON_BOOL : JSON_NULL;
+			value.number = i == 0 ? 1.0 : 0.0;
+			cursor += length;
+			return true;
+		}
+	}
+
+	value.type = JSON_NUMBER;
+	return parseNumber(cursor, end, value.number);
+}
+
+static const JsonValue* getMember(const JsonValue* object, const char* key) {
+	return object ? object->find(key) : nullptr;
+}
+
+static const JsonValue* getElement(const JsonValue& root, const char* key, int index) {
+	const JsonValue* array = root.find(key);
+	return array ? array->at(index) : nullptr;
+}
+
+static double getNumber(const JsonValue* object, const char* key, double fallback) {
+	const JsonValue* value = getMember(object, key);
+	return value && value->type == JSON_NUMBER ? value->number : fallback;
+}
+
+static int toInt(const JsonValue* value, int fallback) {
+	// Indices and enums, anything else is treated as missing
+	if(!value || value->type != JSON_NUMBER || value->number < 0.0 || value->number > 2147483647.0) return fallback;
+	return (int)value->number;
+}
+
+static int getInt(const JsonValue* object, const char* key, int fallback) {
+	return toInt(getMember(object, key), fallback);
+}
+
+static int getComponentSize(int component_type) {
+	switch(component_type) {
+		case GLTF_BYTE:
+		case GLTF_UNSIGNED_BYTE: return 1;
+		case GLTF_SHORT:
+		case GLTF_UNSIGNED_SHORT: return 2;
+		case GLTF_UNSIGNED_INT:
+		case GLTF_FLOAT: return 4;
+	}
+	return 0;
+}
+
+static int getComponentCount(const std::string& type) {
+	if(type == "SCALAR") return 1;
+	if(type == "VEC2") return 2;
+	if(type == "VEC3") return 3;
+	if(type == "VEC4") return 4;
+	if(type == "MAT2") return 4;
+	if(type == "MAT3") return 9;
+	if(type == "MAT4") return 16;
+	return 0;
+}
+
+static float readComponent(const GltfAccessor& accessor, size_t element, int component) {
+	const uint8_t* p = accessor.data + element * accessor.stride + component * getComponentSize(accessor.component_type);
+	switch(accessor.component_type) {
+		case GLTF_FLOAT: {
+			float value;
+			memcpy(&value, p, sizeof(value));
+			return value;
+		}
+		case GLTF_BYTE: {
+			int8_t value = (int8_t)*p;
+			return accessor.normalized ? fmaxf(value / 127.0f, -1.0f) : value;
+		}
+		case GLTF_UNSIGNED_BYTE:
+			return accessor.normalized ? *p / 255.0f : *p;
+		case GLTF_SHORT: {
+			int16_t value;
+			memcpy(&value, p, sizeof(value));
+			return accessor.normalized ? fmaxf(value / 32767.0f, -1.0f) : value;
+		}
+		case GLTF_UNSIGNED_SHORT: {
+			uint16_t value;
+			memcpy(&value, p, sizeof(value));
+			return accessor.normalized ? value / 65535.0f : value;
+		}
+		case GLTF_UNSIGNED_INT: {
+			uint32_t value;
+			memcpy(&value, p, sizeof(value));
+			return (float)value;
+		}
+	}
+	return 0.0f;
+}
+
+static uint32_t readIndex(const GltfAccessor& accessor, size_t element) {
+	const uint8_t* p = accessor.data + element * accessor.stride;
+	if(accessor.component_type == GLTF_UNSIGNED_BYTE) return *p;
+	if(accessor.component_type == GLTF_UNSIGNED_SHORT) {
+		uint16_t value;
+		memcpy(&value, p, sizeof(value));
+		return value;
+	}
+	uint32_t value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+static bool decodeBase64(const char* data, size_t size, std::vector<uint8_t>& out) {
+	uint32_t bits = 0;
+	int bit_count = 0;
+	for(size_t i = 0; i < size && data[i] != '='; i++) {
+		char c = data[i];
+		uint32_t value;
+		if(c >= 'A' && c <= 'Z') value = c - 'A';
+		else if(c >= 'a' && c <= 'z') value = c - 'a' + 26;
+		else if(c >= '0' && c <= '9') value = c - '0' + 52;
+		else if(c == '+') value = 62;
+		else if(c == '/') value = 63;
+		else return false;
+
+		bits = (bits << 6) | value;
+		bit_count += 6;
+		if(bit_count >= 8) {
+			bit_count -= 8;
+			out.push_back((uint8_t)(bits >> bit_count));
+		}
+	}
+	return true;
+}
+
+static std::string decodeUri(const std::string& uri) {
+	// Relative paths only need percent escapes undone
+	std::string path;
+	for(size_t i = 0; i < uri.size(); i++) {
+		uint32_t code;
+		const char* hex = uri.c_str() + i + 1;
+		if(uri[i] == '%' && i + 2 < uri.size() && isxdigit(hex[0]) && isxdigit(hex[1])) {
+			code = strtoul(std::string(hex, 2).c_str(), nullptr, 16);
+			path += (char)code;
+			i += 2;
+		} else {
+			path += uri[i];
+		}
+	}
+	return path;
+}
+
+static glm::mat4 composeTransform(const float translation[3], const float rotation[4], const float scale[3]) {
+	// glTF quaternions are stored x, y, z, w
+	glm::quat orientation(rotation[3], rotation[0], rotation[1], rotation[2]);
+	glm::mat4 transform = glm::translate(glm::mat4(1.0f), glm::vec3(translation[0], translation[1], translation[2]));
+	transform = transform * glm::mat4_cast(orientation);
+	return glm::scale(transform, glm::vec3(scale[0], scale[1], scale[2]));
+}
+
+GltfFile::GltfFile(JobSystem& jobs)
+	: jobs_(jobs), size_(0), copied_count_(0) {}
+
+const char* GltfFile::loadBuffers(const JsonValue& root, const std::string& directory, const uint8_t* bin,
+								  size_t bin_size) {
+	const JsonValue* buffers = root.find("buffers");
+	size_t count = buffers && buffers->type == JSON_ARRAY ? buffers->items.size() : 0;
+	for(size_t i = 0; i < count; i++) {
+		const JsonValue& buffer = buffers->items[i];
+		const JsonValue* uri = buffer.find("uri");
+		double length = getNumber(&buffer, "byteLength", -1.0);
+		if(length < 0.0) return "buffer without byteLength";
+
+		const uint8_t* data = nullptr;
+		size_t size = 0;
+		if(!uri) {
+			// Only the first buffer of a GLB may live in its BIN chunk
+			if(i != 0 || !bin) return "buffer without uri";
+			data = bin;
+			size = bin_size;
+		} else if(uri->type != JSON_STRING) {
+			return "buffer uri is not a string";
+		} else if(uri->string.compare(0, 5, "data:") == 0) {
+			size_t comma = uri->string.find(";base64,");
+			if(comma == std::string::npos) return "data uri is not base64";
+			embedded_.emplace_back();
+			const char* encoded = uri->string.c_str() + comma + 8;
+			if(!decodeBase64(encoded, uri->string.size() - comma - 8, embedded_.back())) return "invalid base64 data";
+			data = embedded_.back().data();
+			size = embedded_.back().size();
+		} else {
+			external_.emplace_back(new MappedFile());
+			if(!external_.back()->open(directory + decodeUri(uri->string))) return "missing buffer file";
+			data = (const uint8_t*)external_.back()->getData();
+			size = external_.back()->getSize();
+			size_ += size;
+		}
+
+		if(length > (double)size) return "buffer shorter than byteLength";
+		buffers_.push_back(data);
+		buffer_sizes_.push_back((size_t)length);
+	}
+	return nullptr;
+}
+
+const char* GltfFile::loadBufferViews(const JsonValue& root) {
+	const JsonValue* views = root.find("bufferViews");
+	size_t count = views && views->type == JSON_ARRAY ? views->items.size() : 0;
+	for(size_t i = 0; i < count; i++) {
+		const JsonValue& view = views->items[i];
+		int buffer = getInt(&view, "buffer", -1);
+		double offset = getNumber(&view, "byteOffset", 0.0);
+		double length = getNumber(&view, "byteLength", -1.0);
+		double stride = getNumber(&view, "byteStride", 0.0);
+		if(buffer < 0 || buffer >= (int)buffers_.size()) return "buffer view references a missing buffer";
+		if(offset < 0.0 || length < 0.0 || offset + length > (double)buffer_sizes_[buffer])
+			return "buffer view out of bounds";
+		if(stride != 0.0 && (stride < 4.0 || stride > 252.0)) return "invalid byteStride";
+
+		views_.push_back(buffers_[buffer] + (size_t)offset);
+		view_sizes_.push_back((size_t)length);
+		view_strides_.push_back((size_t)stride);
+	}
+	return nullptr;
+}
+
+const char* GltfFile::loadAccessor(const JsonValue& root, int index, GltfAccessor& accessor) {
+	// Only reads state that is fixed before the workers start
+	const JsonValue* object = getElement(root, "accessors", index);
+	if(!object) return "missing accessor";
+	if(object->find("sparse")) return "sparse accessors are not supported";
+
+	int view = getInt(object, "bufferView", -1);
+	if(view < 0 || view >= (int)views_.size()) return "accessor without a buffer view";
+	const JsonValue* type = object->find("type");
+	accessor.component_type = getInt(object, "componentType", 0);
+	accessor.components = type && type->type == JSON_STRING ? getComponentCount(type->string) : 0;
+	const JsonValue* normalized = object->find("normalized");
+	accessor.normalized = normalized && normalized->type == JSON_BOOL && normalized->number != 0.0;
+	int component_size = getComponentSize(accessor.component_type);
+	if(component_size == 0 || accessor.components == 0) return "invalid accessor type";
+
+	double offset = getNumber(object, "byteOffset", 0.0);
+	double count = getNumber(object, "count", -1.0);
+	if(offset < 0.0 || count < 0.0) return "invalid accessor range";
+	size_t element_size = (size_t)component_size * accessor.components;
+	accessor.stride = view_strides_[view] ? view_strides_[view] : element_size;
+	accessor.count = (size_t)count;
+	accessor.data = views_[view] + (size_t)offset;
+
+	double last = offset + (count > 0.0 ? (count - 1.0) * accessor.stride + element_size : 0.0);
+	if(last > (double)view_sizes_[view]) return "accessor out of bounds";
+	return nullptr;
+}
+
+const char* GltfFile::loadMeshes(const JsonValue& root) {
+	const JsonValue* meshes = root.find("meshes");
+	size_t count = meshes && meshes->type == JSON_ARRAY ? meshes->items.size() : 0;
+	mesh_primitives_.push_back(0);
+	for(size_t i = 0; i < count; i++) {
+		const JsonValue* primitives = meshes->items[i].find("primitives");
+		if(!primitives || primitives->type != JSON_ARRAY) return "mesh without primitives";
+		for(size_t p = 0; p < primitives->items.size(); p++) {
+			const JsonValue& object = primitives->items[p];
+			Primitive primitive;
+			primitive.position = getInt(getMember(&object, "attributes"), "POSITION", -1);
+			primitive.indices = getInt(&object, "indices", -1);
+			primitive.mode = getInt(&object, "mode", GLTF_TRIANGLES);
+			primitive.material = getInt(&object, "material", -1);
+			if(primitive.position < 0) return "primitive without positions";
+			primitives_.push_back(primitive);
+		}
+		mesh_primitives_.push_back(primitives_.size());
+	}
+
+	// Base color only, the renderer has no textures yet
+	const JsonValue* materials = root.find("materials");
+	size_t material_count = materials && materials->type == JSON_ARRAY ? materials->items.size() : 0;
+	for(size_t i = 0; i < material_count; i++) {
+		const JsonValue* pbr = materials->items[i].find("pbrMetallicRoughness");
+		const JsonValue* factor = getMember(pbr, "baseColorFactor");
+		glm::vec4 color(1.0f);
+		for(int c = 0; c < 4 && factor && factor->at(c); c++)
+			color[c] = factor->at(c)->number;
+		material_colors_.push_back(color);
+	}
+	return nullptr;
+}
+
+const char* GltfFile::buildPrimitive(const JsonValue& root, const Primitive& primitive, Prism& prism, bool& copied) {
+	// Points and lines are skipped, the scene only draws triangles
+	copied = false;
+	if(primitive.mode < GLTF_TRIANGLES || primitive.mode > GLTF_TRIANGLE_FAN) return nullptr;
+
+	GltfAccessor positions;
+	const char* error = loadAccessor(root, primitive.position, positions);
+	if(error) return error;
+	if(positions.components != 3) return "positions are not three components";
+	if(positions.count > (size_t)INT32_MAX / 3) return "too many vertices";
+
+	GltfAccessor indices = { nullptr, positions.count, 0, GLTF_UNSIGNED_INT, 1, false };
+	bool indexed = primitive.indices >= 0;
+	if(indexed) {
+		error = loadAccessor(root, primitive.indices, indices);
+		if(error) return error;
+		bool index_type = indices.component_type == GLTF_UNSIGNED_BYTE || indices.component_type == GLTF_UNSIGNED_SHORT ||
+						  indices.component_type == GLTF_UNSIGNED_INT;
+		if(indices.components != 1 || !index_type) return "invalid index type";
+		if(indices.count > (size_t)INT32_MAX / 3) return "too many indices";
+	}
+
+	// Views need the exact layout the mesh pool uploads, and aligned for the reads
+	bool packed_positions = positions.component_type == GLTF_FLOAT && positions.stride == 3 * sizeof(float) &&
+							(uintptr_t)positions.data % sizeof(float) == 0;
+	bool packed_indices = indexed && primitive.mode == GLTF_TRIANGLES && indices.component_type == GLTF_UNSIGNED_INT &&
+						  indices.stride == sizeof(uint32_t) && (uintptr_t)indices.data % sizeof(uint32_t) == 0;
+
+	// Out of range indices would read other meshes' vertices in the page
+	for(size_t i = 0; indexed && i < indices.count; i++)
+		if(readIndex(indices, i) >= positions.count) return "index out of range";
+
+	if(packed_positions && packed_indices) {
+		// The mappings are read-only, Prism only reads through these pointers
+		size_t index_count = indices.count - indices.count % 3;
+		prism = Prism((float*)positions.data, positions.count * 3, (unsigned int*)indices.data, index_count);
+		return nullptr;
+	}
+
+	std::vector<float> vertices(positions.count * 3);
+	for(size_t v = 0; v < positions.count; v++) {
+		for(int axis = 0; axis < 3; axis++)
+			vertices[v * 3 + axis] = readComponent(positions, v, axis);
+	}
+
+	// Strips alternate winding, fans share their first vertex
+	std::vector<unsigned int> triangles;
+	size_t count = indices.count;
+	if(primitive.mode == GLTF_TRIANGLES) {
+		triangles.resize(count - count % 3);
+		for(size_t i = 0; i < triangles.size(); i++)
+			triangles[i] = indexed ? readIndex(indices, i) : i;
+	} else {
+		for(size_t i = 0; i + 2 < count; i++) {
+			size_t corner[3] = { i, i + 1, i + 2 };
+			if(primitive.mode == GLTF_TRIANGLE_FAN) corner[0] = 0;
+			else if(i % 2 == 1) std::swap(corner[0], corner[1]);
+			for(int c = 0; c < 3; c++)
+				triangles.push_back(indexed ? readIndex(indices, corner[c]) : corner[c]);
+		}
+	}
+
+	prism = Prism(std::move(vertices), std::move(triangles));
+	copied = true;
+	return nullptr;
+}
+
+const char* GltfFile::loadNodes(const JsonValue& root) {
+	const JsonValue* nodes = root.find("nodes");
+	int node_count = nodes && nodes->type == JSON_ARRAY ? nodes->items.size() : 0;
+
+	// The default scene, or every node nobody lists as a child
+	std::vector<int> roots;
+	const JsonValue* scene = getElement(root, "scenes", getInt(&root, "scene", 0));
+	const JsonValue* scene_nodes = getMember(scene, "nodes");
+	if(scene_nodes && scene_nodes->type == JSON_ARRAY) {
+		for(size_t i = 0; i < scene_nodes->items.size(); i++)
+			roots.push_back(toInt(&scene_nodes->items[i], -1));
+	} else {
+		std::vector<bool> is_child(node_count, false);
+		for(int i = 0; i < node_count; i++) {
+			const JsonValue* children = nodes->items[i].find("children");
+			for(int c = 0; children && children->at(c); c++) {
+				int child = toInt(children->at(c), -1);
+				if(child >= 0 && child < node_count) is_child[child] = true;
+			}
+		}
+		for(int i = 0; i < node_count; i++)
+			if(!is_child[i]) roots.push_back(i);
+	}
+
+	// Depth first, so every node is listed after its parent
+	struct Visit {
+		int node;
+		int parent;
+	};
+	std::vector<Visit> stack;
+	std::vector<bool> visited(node_count, false);
+	for(size_t i = 0; i < roots.size(); i++)
+		stack.push_back({ roots[i], -1 });
+
+	while(!stack.empty()) {
+		Visit visit = stack.back();
+		stack.pop_back();
+		if(visit.node < 0 || visit.node >= node_count) return "missing node";
+		if(visited[visit.node]) return "node hierarchy is not a tree";
+		visited[visit.node] = true;
+		const JsonValue& node = nodes->items[visit.node];
+
+		// Either a column-major matrix or translation, rotation and scale
+		glm::mat4 local(1.0f);
+		const JsonValue* matrix = node.find("matrix");
+		if(matrix && matrix->type == JSON_ARRAY && matrix->items.size() == 16) {
+			for(int c = 0; c < 16; c++)
+				local[c / 4][c % 4] = matrix->items[c].number;
+		} else {
+			float translation[3] = { 0.0f, 0.0f, 0.0f };
+			float rotation[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+			float scale[3] = { 1.0f, 1.0f, 1.0f };
+			const JsonValue* values[3] = { node.find("translation"), node.find("rotation"), node.find("scale") };
+			float* targets[3] = { translation, rotation, scale };
+			for(int t = 0; t < 3; t++)
+				for(int c = 0; c < (t == 1 ? 4 : 3) && values[t] && values[t]->at(c); c++)
+					targets[t][c] = values[t]->at(c)->number;
+			local = composeTransform(translation, rotation, scale);
+		}
+		int index = nodes_.size();
+		nodes_.push_back({ visit.parent, local });
+
+		const JsonValue* children = node.find("children");
+		for(int c = 0; children && children->at(c); c++)
+			stack.push_back({ toInt(children->at(c), -1), index });
+
+		int mesh = getInt(&node, "mesh", -1);
+		if(mesh < 0) continue;
+		if(mesh >= (int)mesh_primitives_.size() - 1) return "node references a missing mesh";
+
+		// EXT_mesh_gpu_instancing places the mesh once per instance, relative to the node
+		std::vector<glm::mat4> placements;
+		const JsonValue* instancing = getMember(getMember(&node, "extensions"), "EXT_mesh_gpu_instancing");
+		const JsonValue* attributes = getMember(instancing, "attributes");
+		if(attributes) {
+			const char* names[3] = { "TRANSLATION", "ROTATION", "SCALE" };
+			GltfAccessor accessors[3];
+			bool present[3];
+			size_t instance_count = 0;
+			for(int a = 0; a < 3; a++) {
+				int index = getInt(attributes, names[a], -1);
+				present[a] = index >= 0;
+				if(!present[a]) continue;
+				const char* error = loadAccessor(root, index, accessors[a]);
+				if(error) return error;
+				if(accessors[a].components != (a == 1 ? 4 : 3)) return "invalid instance attribute type";
+				if(instance_count && accessors[a].count != instance_count) return "instance attribute counts differ";
+				instance_count = accessors[a].count;
+			}
+
+			for(size_t i = 0; i < instance_count; i++) {
+				float translation[3] = { 0.0f, 0.0f, 0.0f };
+				float rotation[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+				float scale[3] = { 1.0f, 1.0f, 1.0f };
+				float* targets[3] = { translation, rotation, scale };
+				for(int a = 0; a < 3; a++)
+					for(int c = 0; present[a] && c < accessors[a].components; c++)
+						targets[a][c] = readComponent(accessors[a], i, c);
+				placements.push_back(composeTransform(translation, rotation, scale));
+			}
+		} else {
+			placements.push_back(glm::mat4(1.0f));
+		}
+
+		for(int p = mesh_primitives_[mesh]; p < mesh_primitives_[mesh + 1]; p++) {
+			if(prisms_[p].getIndexCount() == 0) continue;
+			for(size_t i = 0; i < placements.size(); i++)
+				instances_.push_back({ p, index, placements[i] });
+		}
+	}
+	return nullptr;
+}
+
+bool GltfFile::open(const std::string& path) {
+	close();
+	if(!file_.open(path)) return false;
+	size_ = file_.getSize();
+
+	// A GLB is a header, a JSON chunk and an optional BIN chunk
+	const char* error = nullptr;
+	const char* json = file_.getData();
+	size_t json_size = file_.getSize();
+	const uint8_t* bin = nullptr;
+	size_t bin_size = 0;
+	uint32_t header[5];
+	if(json_size >= sizeof(header)) memcpy(header, json, sizeof(header));
+	if(json_size >= sizeof(header) && header[0] == GLB_MAGIC) {
+		if(header[1] != 2) error = "unsupported GLB version";
+		else if(header[2] > json_size || header[2] < sizeof(header) || header[4] != GLB_CHUNK_JSON ||
+				header[3] > header[2] - sizeof(header))
+			error = "invalid GLB chunks";
+
+		if(!error) {
+			size_t bin_offset = sizeof(header) + header[3];
+			uint32_t chunk[2];
+			if(bin_offset + sizeof(chunk) <= header[2]) {
+				memcpy(chunk, json + bin_offset, sizeof(chunk));
+				if(chunk[1] == GLB_CHUNK_BIN && chunk[0] <= header[2] - bin_offset - sizeof(chunk)) {
+					bin = (const uint8_t*)json + bin_offset + sizeof(chunk);
+					bin_size = chunk[0];
+				}
+			}
+			json += sizeof(header);
+			json_size = header[3];
+		}
+	}
+
+	JsonValue root;
+	if(!error) {
+		const char* cursor = json;
+		if(!parseValue(cursor, json + json_size, root, 0) || root.type != JSON_OBJECT) error = "malformed JSON";
+	}
+
+	if(!error) {
+		const JsonValue* version = getMember(getMember(&root, "asset"), "version");
+		if(!version || version->type != JSON_STRING || version->string.compare(0, 2, "2.") != 0)
+			error = "not glTF 2.0";
+	}
+
+	// Instancing is the only extension that changes what gets drawn
+	const JsonValue* required = root.find("extensionsRequired");
+	for(int i = 0; !error && required && required->at(i); i++) {
+		if(required->at(i)->string != "EXT_mesh_gpu_instancing") error = "unsupported required extension";
+	}
+
+	size_t slash = path.find_last_of('/');
+	std::string directory = slash == std::string::npos ? "" : path.substr(0, slash + 1);
+	if(!error) error = loadBuffers(root, directory, bin, bin_size);
+	if(!error) error = loadBufferViews(root);
+	if(!error) error = loadMeshes(root);
+
+	// Accessors are resolved and converted per primitive on the workers
+	if(!error) {
+		int count = primitives_.size();
+		std::vector<const char*> errors(count, nullptr);
+		std::vector<char> copied(count, 0);
+		prisms_.assign(count, Prism(nullptr, 0, nullptr, 0));
+		jobs_.parallelFor(0, count, 1, [&](int begin, int end) {
+			for(int i = begin; i < end; i++) {
+				bool copy = false;
+				errors[i] = buildPrimitive(root, primitives_[i], prisms_[i], copy);
+				copied[i] = copy;
+			}
+		});
+		for(int i = 0; i < count && !error; i++) {
+			error = errors[i];
+			copied_count_ += copied[i];
+		}
+	}
+
+	if(!error) error = loadNodes(root);
+
+	if(error) {
+		std::cerr << "Invalid glTF file " << path << ": " << error << std::endl;
+		close();
+		return false;
+	}
+	return true;
+}
+
+int GltfFile::getPrimitiveCount() {
+	return prisms_.size();
+}
+
+Prism GltfFile::getPrism(int primitive) {
+	return prisms_[primitive];
+}
+
+int GltfFile::getPrimitiveMaterial(int primitive) {
+	int material = primitives_[primitive].material;
+	return material < (int)material_colors_.size() ? material : -1;
+}
+
+const std::vector<glm::vec4>& GltfFile::getMaterialColors() {
+	return material_colors_;
+}
+
+const std::vector<GltfNode>& GltfFile::getNodes() {
+	return nodes_;
+}
+
+const std::vector<GltfInstance>& GltfFile::getInstances() {
+	return instances_;
+}
+
+size_t GltfFile::getSize() {
+	return size_;
+}
+
+int GltfFile::getCopiedCount() {
+	return copied_count_;
+}
+
+void GltfFile::close() {
+	file_.close();
+	external_.clear();
+	embedded_.clear();
+	buffers_.clear();
+	buffer_sizes_.clear();
+	views_.clear();
+	view_sizes_.clear();
+	view_strides_.clear();
+	primitives_.clear();
+	mesh_primitives_.clear();
+	prisms_.clear();
+	material_colors_.clear();
+	nodes_.clear();
+	instances_.clear();
+	size_ = 0;
+	copied_count_ = 0;
+}
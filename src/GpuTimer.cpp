@@ -0,0 +1,48 @@
+#include "GpuTimer.h"
+
+GpuTimer::GpuTimer()
+	: queries_(), pending_(), current_(0), active_(false), milliseconds_(0.0f) {}
+
+void GpuTimer::initialize() {
+	glGenQueries(QUERY_COUNT, queries_);
+}
+
+void GpuTimer::begin() {
+	// Skip this frame rather than wait if the GPU is still behind on the slot
+	active_ = !pending_[current_];
+	if(active_) glBeginQuery(GL_TIME_ELAPSED, queries_[current_]);
+}
+
+void GpuTimer::end() {
+	if(active_) {
+		glEndQuery(GL_TIME_ELAPSED);
+		pending_[current_] = true;
+		current_ = (current_ + 1) % QUERY_COUNT;
+	}
+	collectResults();
+}
+
+void GpuTimer::collectResults() {
+	// Walk from oldest to newest so the latest finished result wins
+	for(int i = 0; i < QUERY_COUNT; i++) {
+		int slot = (current_ + i) % QUERY_COUNT;
+		if(!pending_[slot]) continue;
+
+		GLint available = 0;
+		glGetQueryObjectiv(queries_[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+		if(!available) continue;
+
+		GLuint64 elapsed = 0;
+		glGetQueryObjectui64v(queries_[slot], GL_QUERY_RESULT, &elapsed);
+		milliseconds_ = (float)elapsed / 1000000.0f;
+		pending_[slot] = false;
+	}
+}
+
+float GpuTimer::getMilliseconds() {
+	return milliseconds_;
+}
+
+void GpuTimer::destroy() {
+	glDeleteQueries(QUERY_COUNT, queries_);
+}
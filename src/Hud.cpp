@@ -0,0 +1,216 @@
+#include <cstdio>
+#include <cstring>
+#include "GLStateCache.h"
+#include "Hud.h"
+
+#define HUD_PIXEL_SIZE 3.0f
+#define HUD_MARGIN 10.0f
+#define HUD_GRAPH_MAX_MS 33.3f
+
+static const char* hudVertexShaderSource = R"glsl(
+	#version 330 core
+
+	layout(location = 0) in vec2 aPosition;
+	layout(location = 1) in vec4 aColor;
+
+	uniform vec2 uScreenSize;
+
+	out vec4 vColor;
+
+	void main()
+	{
+		// Pixel coordinates with the origin in the top left corner
+		vec2 ndc = aPosition / uScreenSize * 2.0 - 1.0;
+		gl_Position = vec4(ndc.x, -ndc.y, 0.0, 1.0);
+		vColor = aColor;
+	}
+)glsl";
+
+static const char* hudFragmentShaderSource = R"glsl(
+	#version 330 core
+
+	in vec4 vColor;
+	out vec4 FragColor;
+
+	void main()
+	{
+		FragColor = vColor;
+	}
+)glsl";
+
+// 3x5 glyphs, one row per entry, most significant bit on the left
+static const uint8_t font_glyphs[][5] = {
+	{7, 5, 5, 5, 7}, {2, 6, 2, 2, 7}, {7, 1, 7, 4, 7}, {7, 1, 3, 1, 7}, {5, 5, 7, 1, 1}, // 0-4
+	{7, 4, 7, 1, 7}, {7, 4, 7, 5, 7}, {7, 1, 1, 1, 1}, {7, 5, 7, 5, 7}, {7, 5, 7, 1, 7}, // 5-9
+	{2, 5, 7, 5, 5}, {6, 5, 6, 5, 6}, {3, 4, 4, 4, 3}, {6, 5, 5, 5, 6}, {7, 4, 6, 4, 7}, // A-E
+	{7, 4, 6, 4, 4}, {3, 4, 5, 5, 3}, {5, 5, 7, 5, 5}, {7, 2, 2, 2, 7}, {1, 1, 1, 5, 2}, // F-J
+	{5, 5, 6, 5, 5}, {4, 4, 4, 4, 7}, {5, 7, 7, 5, 5}, {6, 5, 5, 5, 5}, {2, 5, 5, 5, 2}, // K-O
+	{6, 5, 6, 4, 4}, {2, 5, 5, 6, 3}, {6, 5, 6, 5, 5}, {3, 4, 2, 1, 6}, {7, 2, 2, 2, 2}, // P-T
+	{5, 5, 5, 5, 7}, {5, 5, 5, 5, 2}, {5, 5, 7, 7, 5}, {5, 5, 2, 5, 5}, {5, 5, 2, 2, 2}, // U-Y
+	{7, 1, 2, 4, 7},                                                                     // Z
+	{0, 0, 0, 0, 2}, {0, 2, 0, 2, 0}, {0, 0, 7, 0, 0}, {1, 1, 2, 4, 4}                   // . : - /
+};
+
+static const uint8_t* glyphRows(char c) {
+	if(c >= '0' && c <= '9') return font_glyphs[c - '0'];
+	if(c >= 'a' && c <= 'z') c -= 'a' - 'A';
+	if(c >= 'A' && c <= 'Z') return font_glyphs[10 + c - 'A'];
+	switch(c) {
+		case '.': return font_glyphs[36];
+		case ':': return font_glyphs[37];
+		case '-': return font_glyphs[38];
+		case '/': return font_glyphs[39];
+		default: return nullptr;
+	}
+}
+
+Hud::Hud()
+	: visible_(false), shaders_(nullptr), program_(-1), vao_(0), screen_size_location_(-1),
+	  frame_history_(), history_head_(0) {}
+
+void Hud::initialize(RingBuffer& ring, ShaderManager& shaders) {
+	// Compiles in the background, fetched when the overlay is first shown
+	shaders_ = &shaders;
+	program_ = shaders.request("hud", hudVertexShaderSource, hudFragmentShaderSource);
+
+	// Attributes source the ring buffer, each frame draws from its own offset
+	glGenVertexArrays(1, &vao_);
+	gl_state.bindVertexArray(vao_);
+	gl_state.bindBuffer(GL_ARRAY_BUFFER, ring.getBuffer());
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (void*)(2 * sizeof(float)));
+	glEnableVertexAttribArray(1);
+}
+
+void Hud::toggle() {
+	visible_ = !visible_;
+}
+
+bool Hud::isVisible() {
+	return visible_;
+}
+
+void Hud::addQuad(float x, float y, float w, float h, uint32_t color) {
+	Vertex v;
+	v.r = (color >> 24) & 0xFF;
+	v.g = (color >> 16) & 0xFF;
+	v.b = (color >> 8) & 0xFF;
+	v.a = color & 0xFF;
+
+	const float corners[6][2] = { {x, y}, {x + w, y}, {x + w, y + h}, {x + w, y + h}, {x, y + h}, {x, y} };
+	for(int i = 0; i < 6; i++) {
+		v.x = corners[i][0];
+		v.y = corners[i][1];
+		vertices_.push_back(v);
+	}
+}
+
+void Hud::addText(float x, float y, const char* text, uint32_t color) {
+	for(; *text; text++, x += 4 * HUD_PIXEL_SIZE) {
+		const uint8_t* rows = glyphRows(*text);
+		if(!rows) continue;
+
+		for(int row = 0; row < 5; row++) {
+			// Emit one quad per horizontal run of lit pixels
+			int col = 0;
+			while(col < 3) {
+				if(!(rows[row] & (4 >> col))) { col++; continue; }
+				int start = col;
+				while(col < 3 && (rows[row] & (4 >> col))) col++;
+				addQuad(x + start * HUD_PIXEL_SIZE, y + row * HUD_PIXEL_SIZE,
+						(col - start) * HUD_PIXEL_SIZE, HUD_PIXEL_SIZE, color);
+			}
+		}
+	}
+}
+
+void Hud::addGraph(float x, float y, float w, float h) {
+	addQuad(x, y, w, h, 0x00000080);
+
+	float bar_width = w / HISTORY_SIZE;
+	for(int i = 0; i < HISTORY_SIZE; i++) {
+		// Oldest sample on the left
+		float ms = frame_history_[(history_head_ + i) % HISTORY_SIZE];
+		float bar_height = ms / HUD_GRAPH_MAX_MS * h;
+		if(bar_height > h) bar_height = h;
+		uint32_t color = ms > 16.7f ? 0xE04030FF : 0x40D060FF;
+		addQuad(x + i * bar_width, y + h - bar_height, bar_width, bar_height, color);
+	}
+
+	// 60 Hz budget line
+	addQuad(x, y + h - 16.7f / HUD_GRAPH_MAX_MS * h, w, 1.0f, 0xFFFFFF80);
+}
+
+void Hud::draw(const FrameStats& stats, int screen_width, int screen_height, RingBuffer& ring) {
+	frame_history_[history_head_] = stats.frame_ms;
+	history_head_ = (history_head_ + 1) % HISTORY_SIZE;
+
+	if(!visible_) return;
+
+	vertices_.clear();
+
+	float line_height = 7 * HUD_PIXEL_SIZE;
+	float width = HISTORY_SIZE * 2.0f;
+	float x = HUD_MARGIN;
+	float y = HUD_MARGIN;
+
+	addQuad(x - 4.0f, y - 4.0f, width + 8.0f, 8 * line_height + 68.0f, 0x00000060);
+
+	char line[64];
+	snprintf(line, sizeof(line), "FRAME %6.2f MS %5.0f FPS", stats.frame_ms,
+			 stats.frame_ms > 0.0f ? 1000.0f / stats.frame_ms : 0.0f);
+	addText(x, y, line, 0xFFFFFFFF);
+	y += line_height;
+	snprintf(line, sizeof(line), "GPU   %6.2f MS", stats.gpu_ms);
+	addText(x, y, line, 0xFFFFFFFF);
+	y += line_height;
+	snprintf(line, sizeof(line), "DRAWS  %d", stats.draw_calls);
+	addText(x, y, line, 0xFFFFFFFF);
+	y += line_height;
+	snprintf(line, sizeof(line), "PRISMS %d", stats.visible_prisms);
+	addText(x, y, line, 0xFFFFFFFF);
+	y += line_height;
+	snprintf(line, sizeof(line), "TRIS   %d", stats.triangles);
+	addText(x, y, line, 0xFFFFFFFF);
+	y += line_height;
+	snprintf(line, sizeof(line), "BINDS  %d PROG %d VAO", stats.program_binds, stats.vertex_array_binds);
+	addText(x, y, line, 0xFFFFFFFF);
+	y += line_height;
+	snprintf(line, sizeof(line), "STATE  %d SET %d SKIP", stats.gl_calls_issued, stats.gl_calls_suppressed);
+	addText(x, y, line, 0xFFFFFFFF);
+	y += line_height;
+	snprintf(line, sizeof(line), "STREAM %d PEND %ld KB", stats.streaming_pending, stats.uploaded_bytes / 1024);
+	addText(x, y, line, 0xFFFFFFFF);
+	y += line_height;
+
+	addGraph(x, y, width, 60.0f);
+
+	GLsizeiptr size = vertices_.size() * sizeof(Vertex);
+	RingAllocation allocation = ring.allocate(size, sizeof(Vertex));
+	if(!allocation.data) return;
+	memcpy(allocation.data, vertices_.data(), size);
+	ring.flush();
+
+	// Drawn over the scene, whatever depth it left
+	gl_state.polygonMode(GL_FILL);
+	gl_state.setDepthTest(false);
+	gl_state.setBlend(true);
+	gl_state.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	GLuint program = shaders_->get(program_);
+	if(screen_size_location_ < 0) screen_size_location_ = glGetUniformLocation(program, "uScreenSize");
+
+	gl_state.useProgram(program);
+	glUniform2f(screen_size_location_, (float)screen_width, (float)screen_height);
+	gl_state.bindVertexArray(vao_);
+	glDrawArrays(GL_TRIANGLES, (GLint)(allocation.offset / sizeof(Vertex)), (GLsizei)vertices_.size());
+
+	gl_state.setBlend(false);
+	gl_state.setDepthTest(true);
+}
+
+void Hud::destroy() {
+	gl_state.forgetVertexArray(vao_);
+	glDeleteVertexArrays(1, &vao_);
+}
@@ -0,0 +1,164 @@
+#include "JobSystem.h"
+
+// Which system's worker the calling thread is, if any. Kept per system, so
+// a worker of one system submitting to another counts as an outside thread.
+struct WorkerIdentity {
+	const JobSystem* system;
+	int index;
+};
+static thread_local WorkerIdentity current_worker = { nullptr, 0 };
+
+JobSystem::JobSystem(int worker_count)
+	: queued_(0), running_(true) {
+	if(worker_count < 0) {
+		worker_count = (int)std::thread::hardware_concurrency() - 1;
+		if(worker_count < 0) worker_count = 0;
+	}
+
+	for(int i = 0; i <= worker_count; i++)
+		queues_.push_back(std::unique_ptr<WorkQueue>(new WorkQueue()));
+
+	for(int i = 1; i <= worker_count; i++)
+		workers_.push_back(std::thread(&JobSystem::workerLoop, this, i));
+}
+
+JobSystem::~JobSystem() {
+	{
+		std::lock_guard<std::mutex> lock(sleep_mutex_);
+		running_ = false;
+	}
+	wake_.notify_all();
+	for(std::thread& worker : workers_)
+		worker.join();
+}
+
+JobHandle JobSystem::schedule(std::function<void()> work) {
+	return schedule(work, std::vector<JobHandle>());
+}
+
+JobHandle JobSystem::schedule(std::function<void()> work, const std::vector<JobHandle>& dependencies) {
+	JobHandle job = std::make_shared<Job>();
+	job->work = work;
+	job->finished = false;
+
+	// Hold one extra count so the job cannot start while dependencies are registered
+	job->pending_dependencies = dependencies.size() + 1;
+	for(const JobHandle& dependency : dependencies) {
+		std::lock_guard<std::mutex> lock(dependency->continuation_mutex);
+		if(dependency->finished) job->pending_dependencies--;
+		else dependency->continuations.push_back(job);
+	}
+
+	if(--job->pending_dependencies == 0) push(job);
+	return job;
+}
+
+int JobSystem::getQueueIndex() {
+	return current_worker.system == this ? current_worker.index : 0;
+}
+
+void JobSystem::push(const JobHandle& job) {
+	// Workers push to their own deque, every other thread to the shared
+	// injection queue, so each deque keeps a single owner
+	WorkQueue& queue = *queues_[getQueueIndex()];
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.jobs.push_back(job);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(sleep_mutex_);
+		queued_++;
+	}
+	wake_.notify_one();
+}
+
+JobHandle JobSystem::pop() {
+	if(queued_ == 0) return nullptr;
+
+	// A worker takes the newest job from its own deque first, it is the
+	// most likely to be cache hot
+	int index = getQueueIndex();
+	if(index > 0) {
+		WorkQueue& own = *queues_[index];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if(!own.jobs.empty()) {
+			JobHandle job = own.jobs.back();
+			own.jobs.pop_back();
+			queued_--;
+			return job;
+		}
+	}
+
+	// Otherwise the oldest job from the injection queue, then from the
+	// other workers' deques
+	int count = queues_.size();
+	for(int i = 0; i < count; i++) {
+		if(i == index && i > 0) continue;
+		WorkQueue& victim = *queues_[i];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if(!victim.jobs.empty()) {
+			JobHandle job = victim.jobs.front();
+			victim.jobs.pop_front();
+			queued_--;
+			return job;
+		}
+	}
+	return nullptr;
+}
+
+bool JobSystem::runOne() {
+	JobHandle job = pop();
+	if(!job) return false;
+
+	job->work();
+	finish(job);
+	return true;
+}
+
+void JobSystem::finish(const JobHandle& job) {
+	std::vector<JobHandle> ready;
+	{
+		std::lock_guard<std::mutex> lock(job->continuation_mutex);
+		job->finished = true;
+		ready.swap(job->continuations);
+	}
+
+	for(const JobHandle& continuation : ready) {
+		if(--continuation->pending_dependencies == 0) push(continuation);
+	}
+}
+
+void JobSystem::wait(const JobHandle& job) {
+	while(!job->finished) {
+		if(!runOne()) std::this_thread::yield();
+	}
+}
+
+void JobSystem::parallelFor(int begin, int end, int grain, const std::function<void(int, int)>& body) {
+	if(grain < 1) grain = 1;
+
+	std::vector<JobHandle> chunks;
+	for(int start = begin; start < end; start += grain) {
+		int stop = start + grain < end ? start + grain : end;
+		chunks.push_back(schedule([&body, start, stop]() { body(start, stop); }));
+	}
+
+	for(const JobHandle& chunk : chunks)
+		wait(chunk);
+}
+
+int JobSystem::getThreadCount() {
+	return queues_.size();
+}
+
+void JobSystem::workerLoop(int index) {
+	current_worker.system = this;
+	current_worker.index = index;
+	while(running_) {
+		if(runOne()) continue;
+
+		std::unique_lock<std::mutex> lock(sleep_mutex_);
+		wake_.wait(lock, [this]() { return queued_ > 0 || !running_; });
+	}
+}
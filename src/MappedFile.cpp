@@ -0,0 +1,59 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <iostream>
+#include "MappedFile.h"
+
+MappedFile::MappedFile()
+	: descriptor_(-1), data_(nullptr), size_(0) {}
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+bool MappedFile::open(const std::string& path) {
+	close();
+
+	descriptor_ = ::open(path.c_str(), O_RDONLY);
+	if(descriptor_ < 0) {
+		std::cerr << "Failed to open " << path << std::endl;
+		return false;
+	}
+
+	struct stat info;
+	if(fstat(descriptor_, &info) != 0 || info.st_size == 0) {
+		std::cerr << "Failed to map " << path << ": empty or unreadable" << std::endl;
+		close();
+		return false;
+	}
+
+	void* data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, descriptor_, 0);
+	if(data == MAP_FAILED) {
+		std::cerr << "Failed to map " << path << std::endl;
+		close();
+		return false;
+	}
+
+	// Chunks are parsed in parallel, so ask for the whole file to be read ahead
+	madvise(data, info.st_size, MADV_WILLNEED);
+	data_ = (const char*)data;
+	size_ = info.st_size;
+	return true;
+}
+
+const char* MappedFile::getData() {
+	return data_;
+}
+
+size_t MappedFile::getSize() {
+	return size_;
+}
+
+void MappedFile::close() {
+	if(data_) munmap((void*)data_, size_);
+	if(descriptor_ >= 0) ::close(descriptor_);
+	descriptor_ = -1;
+	data_ = nullptr;
+	size_ = 0;
+}
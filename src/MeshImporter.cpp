@@ -0,0 +1,665 @@
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include "MappedFile.h"
+#include "MeshImporter.h"
+
+#define EMPTY_SLOT 0xFFFFFFFFu
+
+static const double powers_of_ten[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static inline bool isSpace(char c) {
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline bool isDigit(char c) {
+	return c >= '0' && c <= '9';
+}
+
+// Decimal float such as -1.25e-3, without locale or stream overhead. Up to
+// 19 significant digits are kept and scaled in double precision, plenty for
+// a float. Returns the character after the number, nullptr if there is none.
+static const char* parseFloat(const char* p, const char* end, float& value) {
+	while(p < end && isSpace(*p)) p++;
+	bool negative = false;
+	if(p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+
+	uint64_t mantissa = 0;
+	int digits = 0;
+	int exponent = 0;
+	bool any_digit = false;
+	for(; p < end && isDigit(*p); p++) {
+		any_digit = true;
+		if(digits < 19) {
+			mantissa = mantissa * 10 + (*p - '0');
+			if(mantissa) digits++;
+		} else {
+			exponent++;
+		}
+	}
+	if(p < end && *p == '.') {
+		for(p++; p < end && isDigit(*p); p++) {
+			any_digit = true;
+			if(digits < 19) {
+				mantissa = mantissa * 10 + (*p - '0');
+				if(mantissa) digits++;
+				exponent--;
+			}
+		}
+	}
+	if(!any_digit) return nullptr;
+
+	if(p < end && (*p == 'e' || *p == 'E')) {
+		const char* q = p + 1;
+		bool negative_exponent = false;
+		if(q < end && (*q == '-' || *q == '+')) negative_exponent = *q++ == '-';
+		if(q < end && isDigit(*q)) {
+			int power = 0;
+			for(; q < end && isDigit(*q); q++)
+				if(power < 10000) power = power * 10 + (*q - '0');
+			exponent += negative_exponent ? -power : power;
+			p = q;
+		}
+	}
+
+	double result = (double)mantissa;
+	if(exponent < 0) result = exponent >= -22 ? result / powers_of_ten[-exponent] : result * pow(10.0, exponent);
+	else if(exponent > 0) result = exponent <= 22 ? result * powers_of_ten[exponent] : result * pow(10.0, exponent);
+	value = (float)(negative ? -result : result);
+	return p;
+}
+
+static const char* parseInt(const char* p, const char* end, long long& value) {
+	while(p < end && isSpace(*p)) p++;
+	bool negative = false;
+	if(p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+	if(p >= end || !isDigit(*p)) return nullptr;
+
+	long long result = 0;
+	for(; p < end && isDigit(*p); p++)
+		if(result < LLONG_MAX / 10) result = result * 10 + (*p - '0');
+	value = negative ? -result : result;
+	return p;
+}
+
+static const char* lineEnd(const char* p, const char* end) {
+	const char* newline = (const char*)memchr(p, '\n', end - p);
+	return newline ? newline : end;
+}
+
+// Chunk boundaries at line starts, roughly CHUNK_SIZE apart
+static std::vector<size_t> splitLines(const char* data, size_t size) {
+	std::vector<size_t> bounds(1, 0);
+	size_t position = 0;
+	while(position < size) {
+		size_t next = position + MeshImporter::CHUNK_SIZE;
+		if(next < size) next = lineEnd(data + next, data + size) - data + 1;
+		if(next > size) next = size;
+		bounds.push_back(next);
+		position = next;
+	}
+	return bounds;
+}
+
+static uint32_t hashPosition(const uint32_t* bits) {
+	uint32_t hash = bits[0] * 0x9E3779B1u ^ bits[1] * 0x85EBCA77u ^ bits[2] * 0xC2B2AE3Du;
+	hash ^= hash >> 15;
+	hash *= 0x2C1B3C6Du;
+	hash ^= hash >> 13;
+	return hash;
+}
+
+MeshImporter::MeshImporter(JobSystem& jobs)
+	: jobs_(jobs), merged_count_(0) {}
+
+bool MeshImporter::load(const std::string& path, ImportedMesh& mesh) {
+	MappedFile file;
+	if(!file.open(path)) return false;
+
+	std::string extension = path.substr(path.find_last_of('.') + 1);
+	std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+	if(extension == "obj") return parseObj(file.getData(), file.getSize(), mesh);
+	if(extension == "ply") return parsePly(file.getData(), file.getSize(), mesh);
+
+	std::cerr << "Unsupported model format: " << path << std::endl;
+	return false;
+}
+
+size_t MeshImporter::getMergedCount() {
+	return merged_count_;
+}
+
+bool MeshImporter::mergeDuplicates(ImportedMesh& mesh) {
+	size_t vertex_count = mesh.vertices.size() / 3;
+	if(vertex_count >= EMPTY_SLOT || mesh.indices.size() > INT_MAX) {
+		std::cerr << "Model too large: " << vertex_count << " vertices" << std::endl;
+		return false;
+	}
+
+	// Open addressing with linear probing, at most half full. Unique
+	// positions are compacted in place, they never move past their source.
+	size_t capacity = 16;
+	while(capacity < vertex_count * 2) capacity *= 2;
+	std::vector<uint32_t> table(capacity, EMPTY_SLOT);
+	std::vector<uint32_t> remap(vertex_count);
+	float* positions = mesh.vertices.data();
+	uint32_t unique = 0;
+
+	for(size_t i = 0; i < vertex_count; i++) {
+		// Adding zero turns -0 into +0 so both merge
+		float position[3] = { positions[i * 3] + 0.0f, positions[i * 3 + 1] + 0.0f, positions[i * 3 + 2] + 0.0f };
+		uint32_t bits[3];
+		memcpy(bits, position, sizeof(bits));
+
+		size_t slot = hashPosition(bits) & (capacity - 1);
+		while(true) {
+			uint32_t candidate = table[slot];
+			if(candidate == EMPTY_SLOT) {
+				memcpy(&positions[unique * 3], position, sizeof(position));
+				table[slot] = unique;
+				remap[i] = unique++;
+				break;
+			}
+			if(memcmp(&positions[candidate * 3], position, sizeof(position)) == 0) {
+				remap[i] = candidate;
+				break;
+			}
+			slot = (slot + 1) & (capacity - 1);
+		}
+	}
+
+	merged_count_ = vertex_count - unique;
+	mesh.vertices.resize((size_t)unique * 3);
+	jobs_.parallelFor(0, mesh.indices.size(), 1 << 16, [&](int begin, int end) {
+		for(int i = begin; i < end; i++)
+			mesh.indices[i] = remap[mesh.indices[i]];
+	});
+	return true;
+}
+
+// OBJ
+
+struct ObjCorner {
+	long long index;
+	bool relative;
+};
+
+// Positions and triangle corners of one chunk. Positive OBJ indices are
+// global; negative ones count back from the chunk's own vertex count and are
+// rebased once the vertex counts of earlier chunks are known.
+struct ObjChunk {
+	std::vector<float> positions;
+	std::vector<long long> corners;
+	std::vector<size_t> relative_corners;
+	bool failed;
+};
+
+static void emitCorner(ObjChunk& chunk, const ObjCorner& corner) {
+	if(corner.relative) chunk.relative_corners.push_back(chunk.corners.size());
+	chunk.corners.push_back(corner.index);
+}
+
+static void parseObjChunk(const char* p, const char* end, ObjChunk& chunk) {
+	std::vector<ObjCorner> polygon;
+	chunk.failed = false;
+	while(p < end) {
+		const char* line_end = lineEnd(p, end);
+		while(p < line_end && isSpace(*p)) p++;
+
+		if(line_end - p > 1 && p[0] == 'v' && isSpace(p[1])) {
+			float x, y, z;
+			const char* q = parseFloat(p + 1, line_end, x);
+			if(q) q = parseFloat(q, line_end, y);
+			if(q) q = parseFloat(q, line_end, z);
+			if(!q) {
+				chunk.failed = true;
+				return;
+			}
+			chunk.positions.push_back(x);
+			chunk.positions.push_back(y);
+			chunk.positions.push_back(z);
+		} else if(line_end - p > 1 && p[0] == 'f' && isSpace(p[1])) {
+			polygon.clear();
+			const char* q = p + 1;
+			while(true) {
+				while(q < line_end && isSpace(*q)) q++;
+				if(q >= line_end || *q == '#') break;
+
+				long long index;
+				q = parseInt(q, line_end, index);
+				if(!q || index == 0) {
+					chunk.failed = true;
+					return;
+				}
+				// Texture coordinate and normal references are not used
+				while(q < line_end && !isSpace(*q)) q++;
+
+				long long local_count = chunk.positions.size() / 3;
+				ObjCorner corner = { index > 0 ? index - 1 : local_count + index, index < 0 };
+				polygon.push_back(corner);
+			}
+
+			for(size_t i = 2; i < polygon.size(); i++) {
+				emitCorner(chunk, polygon[0]);
+				emitCorner(chunk, polygon[i - 1]);
+				emitCorner(chunk, polygon[i]);
+			}
+		}
+		p = line_end + 1;
+	}
+}
+
+bool MeshImporter::parseObj(const char* data, size_t size, ImportedMesh& mesh) {
+	std::vector<size_t> bounds = splitLines(data, size);
+	int chunk_count = bounds.size() - 1;
+	std::vector<ObjChunk> chunks(chunk_count);
+	jobs_.parallelFor(0, chunk_count, 1, [&](int begin, int end) {
+		for(int c = begin; c < end; c++)
+			parseObjChunk(data + bounds[c], data + bounds[c + 1], chunks[c]);
+	});
+
+	// Where each chunk's output starts in the combined arrays
+	std::vector<size_t> vertex_base(chunk_count + 1, 0);
+	std::vector<size_t> index_base(chunk_count + 1, 0);
+	for(int c = 0; c < chunk_count; c++) {
+		if(chunks[c].failed) {
+			std::cerr << "Malformed OBJ data near byte " << bounds[c] << std::endl;
+			return false;
+		}
+		vertex_base[c + 1] = vertex_base[c] + chunks[c].positions.size() / 3;
+		index_base[c + 1] = index_base[c] + chunks[c].corners.size();
+	}
+
+	size_t vertex_count = vertex_base[chunk_count];
+	if(vertex_count >= EMPTY_SLOT || index_base[chunk_count] > INT_MAX) {
+		std::cerr << "Model too large: " << vertex_count << " vertices" << std::endl;
+		return false;
+	}
+
+	mesh.vertices.resize(vertex_count * 3);
+	mesh.indices.resize(index_base[chunk_count]);
+	std::atomic<bool> valid(true);
+	jobs_.parallelFor(0, chunk_count, 1, [&](int begin, int end) {
+		for(int c = begin; c < end; c++) {
+			ObjChunk& chunk = chunks[c];
+			std::copy(chunk.positions.begin(), chunk.positions.end(), mesh.vertices.begin() + vertex_base[c] * 3);
+			for(size_t i = 0; i < chunk.relative_corners.size(); i++)
+				chunk.corners[chunk.relative_corners[i]] += vertex_base[c];
+
+			for(size_t i = 0; i < chunk.corners.size(); i++) {
+				long long index = chunk.corners[i];
+				if(index < 0 || index >= (long long)vertex_count) valid = false;
+				mesh.indices[index_base[c] + i] = (unsigned int)index;
+			}
+
+			// Release chunk memory as soon as it is copied
+			std::vector<float>().swap(chunk.positions);
+			std::vector<long long>().swap(chunk.corners);
+		}
+	});
+
+	if(!valid) {
+		std::cerr << "OBJ face references a missing vertex" << std::endl;
+		return false;
+	}
+	return mergeDuplicates(mesh);
+}
+
+// PLY
+
+enum PlyType { PLY_INT8, PLY_UINT8, PLY_INT16, PLY_UINT16, PLY_INT32, PLY_UINT32, PLY_FLOAT32, PLY_FLOAT64, PLY_INVALID };
+
+struct PlyProperty {
+	std::string name;
+	PlyType type;
+	PlyType count_type; // PLY_INVALID unless this is a list
+	size_t offset;
+};
+
+struct PlyElement {
+	std::string name;
+	size_t count;
+	std::vector<PlyProperty> properties;
+	bool has_list;
+	size_t stride; // Record size while there is no list
+};
+
+static int plyTypeSize(PlyType type) {
+	static const int sizes[] = { 1, 1, 2, 2, 4, 4, 4, 8, 0 };
+	return sizes[type];
+}
+
+static bool isPlyFloat(PlyType type) {
+	return type == PLY_FLOAT32 || type == PLY_FLOAT64;
+}
+
+static double readPlyValue(const char* p, PlyType type, bool swap) {
+	unsigned char bytes[8];
+	int size = plyTypeSize(type);
+	memcpy(bytes, p, size);
+	if(swap) std::reverse(bytes, bytes + size);
+
+	switch(type) {
+		case PLY_INT8: { int8_t v; memcpy(&v, bytes, 1); return v; }
+		case PLY_UINT8: { uint8_t v; memcpy(&v, bytes, 1); return v; }
+		case PLY_INT16: { int16_t v; memcpy(&v, bytes, 2); return v; }
+		case PLY_UINT16: { uint16_t v; memcpy(&v, bytes, 2); return v; }
+		case PLY_INT32: { int32_t v; memcpy(&v, bytes, 4); return v; }
+		case PLY_UINT32: { uint32_t v; memcpy(&v, bytes, 4); return v; }
+		case PLY_FLOAT32: { float v; memcpy(&v, bytes, 4); return v; }
+		default: { double v; memcpy(&v, bytes, 8); return v; }
+	}
+}
+
+static const char* parsePlyValue(const char* p, const char* end, PlyType type, double& value) {
+	if(isPlyFloat(type)) {
+		float parsed;
+		p = parseFloat(p, end, parsed);
+		value = parsed;
+	} else {
+		long long parsed;
+		p = parseInt(p, end, parsed);
+		value = (double)parsed;
+	}
+	return p;
+}
+
+static std::vector<std::string> splitWords(const char* p, const char* end) {
+	std::vector<std::string> words;
+	while(p < end) {
+		while(p < end && isSpace(*p)) p++;
+		const char* start = p;
+		while(p < end && !isSpace(*p)) p++;
+		if(p > start) words.push_back(std::string(start, p));
+	}
+	return words;
+}
+
+static int findProperty(const std::vector<std::string>& names, const std::string& name) {
+	for(size_t i = 0; i < names.size(); i++)
+		if(names[i] == name) return i;
+	return -1;
+}
+
+bool MeshImporter::parsePly(const char* data, size_t size, ImportedMesh& mesh) {
+	static const char* type_names[][2] = {
+		{ "char", "int8" }, { "uchar", "uint8" }, { "short", "int16" }, { "ushort", "uint16" },
+		{ "int", "int32" }, { "uint", "uint32" }, { "float", "float32" }, { "double", "float64" }
+	};
+
+	const char* end = data + size;
+	const char* p = data;
+	std::vector<PlyElement> elements;
+	std::string format;
+	bool header_done = false;
+	while(p < end && !header_done) {
+		const char* line_end = lineEnd(p, end);
+		std::vector<std::string> words = splitWords(p, line_end);
+		p = line_end + 1;
+		if(words.empty()) continue;
+
+		if(words[0] == "format" && words.size() > 1) {
+			format = words[1];
+		} else if(words[0] == "element" && words.size() > 2) {
+			PlyElement element = { words[1], (size_t)strtoull(words[2].c_str(), nullptr, 10),
+								   std::vector<PlyProperty>(), false, 0 };
+			elements.push_back(element);
+		} else if(words[0] == "property" && !elements.empty()) {
+			bool list = words.size() > 4 && words[1] == "list";
+			PlyProperty property = { words.back(), PLY_INVALID, PLY_INVALID, elements.back().stride };
+			for(int t = 0; t < PLY_INVALID; t++) {
+				for(int alias = 0; alias < 2; alias++) {
+					if(words[list ? 3 : 1] == type_names[t][alias]) property.type = (PlyType)t;
+					if(list && words[2] == type_names[t][alias]) property.count_type = (PlyType)t;
+				}
+			}
+			if(property.type == PLY_INVALID || (list && property.count_type == PLY_INVALID)) {
+				std::cerr << "Unsupported PLY property type" << std::endl;
+				return false;
+			}
+			elements.back().properties.push_back(property);
+			elements.back().has_list |= list;
+			elements.back().stride += plyTypeSize(property.type);
+		} else if(words[0] == "end_header") {
+			header_done = true;
+		}
+	}
+
+	if(size < 4 || memcmp(data, "ply", 3) != 0 || !header_done) {
+		std::cerr << "Missing PLY header" << std::endl;
+		return false;
+	}
+	if(p > end) p = end;
+
+	if(format == "ascii") return parsePlyAscii(p, end, elements, mesh);
+	if(format == "binary_little_endian" || format == "binary_big_endian") {
+		uint16_t probe = 1;
+		bool little_endian_host = *(uint8_t*)&probe == 1;
+		bool swap = (format == "binary_little_endian") != little_endian_host;
+		return parsePlyBinary(p, end, elements, swap, mesh);
+	}
+	std::cerr << "Unsupported PLY format: " << format << std::endl;
+	return false;
+}
+
+bool MeshImporter::parsePlyBinary(const char* body, const char* end, const std::vector<PlyElement>& elements,
+								  bool swap, ImportedMesh& mesh) {
+	const char* cursor = body;
+	size_t vertex_count = 0;
+	for(size_t e = 0; e < elements.size(); e++) {
+		const PlyElement& element = elements[e];
+		std::vector<std::string> names;
+		for(size_t i = 0; i < element.properties.size(); i++)
+			names.push_back(element.properties[i].name);
+
+		// Fixed size records, vertices are read in parallel straight from the mapping
+		if(!element.has_list) {
+			if((size_t)(end - cursor) / (element.stride ? element.stride : 1) < element.count) {
+				cursor = end + 1;
+				break;
+			}
+			if(element.name == "vertex") {
+				int x = findProperty(names, "x"), y = findProperty(names, "y"), z = findProperty(names, "z");
+				if(x < 0 || y < 0 || z < 0 || element.count > INT_MAX) {
+					std::cerr << "PLY vertices need x, y and z" << std::endl;
+					return false;
+				}
+				const PlyProperty* axes[3] = { &element.properties[x], &element.properties[y], &element.properties[z] };
+				vertex_count = element.count;
+				mesh.vertices.resize(vertex_count * 3);
+				jobs_.parallelFor(0, vertex_count, 1 << 16, [&](int first, int last) {
+					for(int i = first; i < last; i++) {
+						const char* record = cursor + (size_t)i * element.stride;
+						for(int axis = 0; axis < 3; axis++)
+							mesh.vertices[(size_t)i * 3 + axis] = (float)readPlyValue(record + axes[axis]->offset, axes[axis]->type, swap);
+					}
+				});
+			}
+			cursor += element.count * element.stride;
+			continue;
+		}
+
+		int indices = element.name == "face" ? findProperty(names, "vertex_indices") : -1;
+		if(indices < 0 && element.name == "face") indices = findProperty(names, "vertex_index");
+
+		// Faces that are all triangles have a fixed stride too, which is checked
+		// in parallel before the indices are read the same way
+		if(indices >= 0 && element.properties.size() == 1 && element.count <= INT_MAX / 3) {
+			const PlyProperty& list = element.properties[0];
+			size_t count_size = plyTypeSize(list.count_type);
+			size_t stride = count_size + 3 * plyTypeSize(list.type);
+			if((size_t)(end - cursor) / stride >= element.count) {
+				std::atomic<bool> triangles(true);
+				jobs_.parallelFor(0, element.count, 1 << 16, [&](int first, int last) {
+					for(int i = first; i < last && triangles; i++)
+						if(readPlyValue(cursor + (size_t)i * stride, list.count_type, swap) != 3) triangles = false;
+				});
+
+				if(triangles) {
+					size_t index_base = mesh.indices.size();
+					mesh.indices.resize(index_base + element.count * 3);
+					jobs_.parallelFor(0, element.count, 1 << 16, [&](int first, int last) {
+						for(int i = first; i < last; i++) {
+							const char* record = cursor + (size_t)i * stride + count_size;
+							for(int corner = 0; corner < 3; corner++)
+								mesh.indices[index_base + (size_t)i * 3 + corner] =
+									(unsigned int)readPlyValue(record + corner * plyTypeSize(list.type), list.type, swap);
+						}
+					});
+					cursor += element.count * stride;
+					continue;
+				}
+			}
+		}
+
+		// Variable size records are walked one at a time
+		for(size_t record = 0; record < element.count; record++) {
+			for(size_t i = 0; i < element.properties.size(); i++) {
+				const PlyProperty& property = element.properties[i];
+				int value_size = plyTypeSize(property.type);
+				if(property.count_type == PLY_INVALID) {
+					cursor += value_size;
+					continue;
+				}
+
+				if(end - cursor < plyTypeSize(property.count_type)) {
+					cursor = end + 1;
+					break;
+				}
+				size_t count = (size_t)readPlyValue(cursor, property.count_type, swap);
+				cursor += plyTypeSize(property.count_type);
+				if((size_t)(end - cursor) / value_size < count) {
+					cursor = end + 1;
+					break;
+				}
+
+				if((int)i == indices) {
+					for(size_t corner = 2; corner < count; corner++) {
+						mesh.indices.push_back((unsigned int)readPlyValue(cursor, property.type, swap));
+						mesh.indices.push_back((unsigned int)readPlyValue(cursor + (corner - 1) * value_size, property.type, swap));
+						mesh.indices.push_back((unsigned int)readPlyValue(cursor + corner * value_size, property.type, swap));
+					}
+				}
+				cursor += count * value_size;
+			}
+			if(cursor > end) break;
+		}
+	}
+
+	if(cursor > end || mesh.vertices.empty()) {
+		std::cerr << "Truncated PLY data" << std::endl;
+		return false;
+	}
+	for(size_t i = 0; i < mesh.indices.size(); i++) {
+		if(mesh.indices[i] >= vertex_count) {
+			std::cerr << "PLY face references a missing vertex" << std::endl;
+			return false;
+		}
+	}
+	return mergeDuplicates(mesh);
+}
+
+bool MeshImporter::parsePlyAscii(const char* body, const char* end, const std::vector<PlyElement>& elements,
+								 ImportedMesh& mesh) {
+	// Every record is one line. Count lines per chunk first, then each chunk
+	// knows which element and record its first line belongs to.
+	std::vector<size_t> bounds = splitLines(body, end - body);
+	int chunk_count = bounds.size() - 1;
+	std::vector<size_t> first_line(chunk_count + 1, 0);
+	jobs_.parallelFor(0, chunk_count, 1, [&](int begin, int end) {
+		for(int c = begin; c < end; c++)
+			first_line[c + 1] = std::count(body + bounds[c], body + bounds[c + 1], '\n');
+	});
+	for(int c = 0; c < chunk_count; c++)
+		first_line[c + 1] += first_line[c];
+
+	size_t vertex_count = 0;
+	std::vector<size_t> element_line(elements.size() + 1, 0);
+	for(size_t e = 0; e < elements.size(); e++) {
+		element_line[e + 1] = element_line[e] + elements[e].count;
+		if(elements[e].name == "vertex") vertex_count = elements[e].count;
+	}
+	mesh.vertices.assign(vertex_count * 3, 0.0f);
+
+	std::vector<std::vector<unsigned int>> chunk_indices(chunk_count);
+	std::atomic<bool> valid(true);
+	jobs_.parallelFor(0, chunk_count, 1, [&](int begin, int end_chunk) {
+		std::vector<double> values;
+		for(int c = begin; c < end_chunk && valid; c++) {
+			const char* p = body + bounds[c];
+			const char* chunk_end = body + bounds[c + 1];
+			size_t line = first_line[c];
+			size_t e = 0;
+			for(; p < chunk_end; line++) {
+				const char* line_end = lineEnd(p, chunk_end);
+				while(e < elements.size() && line >= element_line[e + 1]) e++;
+				if(e == elements.size()) break;
+
+				const PlyElement& element = elements[e];
+				bool vertex = element.name == "vertex";
+				bool face = element.name == "face";
+				if(vertex || face) {
+					const char* q = p;
+					for(size_t i = 0; i < element.properties.size() && q; i++) {
+						const PlyProperty& property = element.properties[i];
+						double value;
+						if(property.count_type == PLY_INVALID) {
+							q = parsePlyValue(q, line_end, property.type, value);
+							// Properties named x, y and z are the position
+							if(vertex && q && property.name.size() == 1 && property.name[0] >= 'x' && property.name[0] <= 'z')
+								mesh.vertices[(line - element_line[e]) * 3 + property.name[0] - 'x'] = (float)value;
+							continue;
+						}
+
+						q = parsePlyValue(q, line_end, property.count_type, value);
+						size_t count = q ? (size_t)value : 0;
+						values.clear();
+						for(size_t k = 0; k < count && q; k++) {
+							q = parsePlyValue(q, line_end, property.type, value);
+							values.push_back(value);
+						}
+
+						bool indices = property.name == "vertex_indices" || property.name == "vertex_index";
+						if(face && indices && q) {
+							for(size_t corner = 2; corner < values.size(); corner++) {
+								unsigned int triangle[3] = { (unsigned int)values[0], (unsigned int)values[corner - 1],
+															 (unsigned int)values[corner] };
+								for(int k = 0; k < 3; k++) {
+									if(triangle[k] >= vertex_count) valid = false;
+									chunk_indices[c].push_back(triangle[k]);
+								}
+							}
+						}
+					}
+					if(!q) valid = false;
+				}
+				p = line_end + 1;
+			}
+		}
+	});
+
+	if(!valid || vertex_count == 0) {
+		std::cerr << "Malformed PLY data" << std::endl;
+		return false;
+	}
+
+	std::vector<size_t> index_base(chunk_count + 1, 0);
+	for(int c = 0; c < chunk_count; c++)
+		index_base[c + 1] = index_base[c] + chunk_indices[c].size();
+	if(index_base[chunk_count] > INT_MAX) {
+		std::cerr << "Model too large: " << index_base[chunk_count] << " indices" << std::endl;
+		return false;
+	}
+	mesh.indices.resize(index_base[chunk_count]);
+	jobs_.parallelFor(0, chunk_count, 1, [&](int begin, int end) {
+		for(int c = begin; c < end; c++)
+			std::copy(chunk_indices[c].begin(), chunk_indices[c].end(), mesh.indices.begin() + index_base[c]);
+	});
+	return mergeDuplicates(mesh);
+}
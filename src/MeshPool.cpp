@@ -0,0 +1,318 @@
+#include "GLStateCache.h"
+#include "MeshPool.h"
+
+static void copyWithinBuffer(GLuint buffer, GLintptr from, GLintptr to, GLsizeiptr size) {
+	// Source and destination never overlap since the destination is a free hole
+	gl_state.bindBuffer(GL_COPY_READ_BUFFER, buffer);
+	gl_state.bindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, from, to, size);
+}
+
+static void copyBetweenBuffers(GLuint source, GLintptr from, GLuint destination, GLintptr to, GLsizeiptr size) {
+	gl_state.bindBuffer(GL_COPY_READ_BUFFER, source);
+	gl_state.bindBuffer(GL_COPY_WRITE_BUFFER, destination);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, from, to, size);
+}
+
+static void uploadToBuffer(GLuint buffer, GLintptr offset, GLsizeiptr size, const void* data) {
+	// Upload through the copy target so the bound VAO's element buffer is untouched
+	gl_state.bindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, offset, size, data);
+}
+
+void MeshPool::quantizePositions(const float* positions, GLsizei vertex_count, float scale[3], float offset[3],
+								 std::vector<uint32_t>& words) {
+	float low[3] = { positions[0], positions[1], positions[2] };
+	float high[3] = { positions[0], positions[1], positions[2] };
+	for(GLsizei i = 1; i < vertex_count; i++) {
+		for(int axis = 0; axis < 3; axis++) {
+			float value = positions[i * 3 + axis];
+			if(value < low[axis]) low[axis] = value;
+			if(value > high[axis]) high[axis] = value;
+		}
+	}
+
+	for(int axis = 0; axis < 3; axis++) {
+		float extent = high[axis] - low[axis];
+		scale[axis] = extent > 0.0f ? extent : 1.0f;
+		offset[axis] = low[axis];
+	}
+
+	// x and y share the first word, z fills the low half of the second
+	words.resize((size_t)vertex_count * 2);
+	for(GLsizei i = 0; i < vertex_count; i++) {
+		uint32_t quantized[3];
+		for(int axis = 0; axis < 3; axis++) {
+			float normalized = (positions[i * 3 + axis] - offset[axis]) / scale[axis];
+			quantized[axis] = (uint32_t)(normalized * 65535.0f + 0.5f);
+		}
+		words[i * 2] = quantized[0] | (quantized[1] << 16);
+		words[i * 2 + 1] = quantized[2];
+	}
+}
+
+MeshPool::Page::Page(GLsizei vertex_words, GLsizei index_capacity)
+	: vao(0), quantized_vao(0), vbo(0), ebo(0), vertices(vertex_words), indices(index_capacity) {}
+
+MeshPool::MeshPool(GLsizei page_vertices, GLsizei page_indices, int retire_frames)
+	: page_vertices_(page_vertices), page_indices_(page_indices), retire_frames_(retire_frames), frame_(0) {}
+
+GLsizei MeshPool::getVertexWords(VertexFormat format) {
+	return format == VERTEX_FORMAT_UNORM16X3 ? 2 : 3;
+}
+
+int MeshPool::createPage(GLsizei vertex_words, GLsizei index_capacity) {
+	Page page(vertex_words, index_capacity);
+
+	glGenVertexArrays(1, &page.vao);
+	glGenVertexArrays(1, &page.quantized_vao);
+	glGenBuffers(1, &page.vbo);
+	glGenBuffers(1, &page.ebo);
+
+	gl_state.bindBuffer(GL_ARRAY_BUFFER, page.vbo);
+	glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)vertex_words * sizeof(uint32_t), nullptr, GL_STATIC_DRAW);
+
+	// Define vertex attributes (position attribute), one layout per format
+	gl_state.bindVertexArray(page.vao);
+	gl_state.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, page.ebo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)index_capacity * sizeof(unsigned int), nullptr, GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(uint32_t), (void*)0);
+	glEnableVertexAttribArray(0);
+
+	gl_state.bindVertexArray(page.quantized_vao);
+	gl_state.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, page.ebo);
+	glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, 2 * sizeof(uint32_t), (void*)0);
+	glEnableVertexAttribArray(0);
+
+	pages_.push_back(page);
+	return pages_.size() - 1;
+}
+
+MeshHandle MeshPool::allocateRange(MeshRange& range, GLsizei word_count, GLsizei stride) {
+	// Words are aligned to the format's stride so base_vertex stays whole
+	GLsizei index_count = range.index_count;
+	long first_word = FreeListAllocator::INVALID_OFFSET;
+	for(size_t i = 0; i < pages_.size() && range.page < 0; i++) {
+		first_word = pages_[i].vertices.allocate(word_count, stride);
+		if(first_word == FreeListAllocator::INVALID_OFFSET) continue;
+
+		long first_index = pages_[i].indices.allocate(index_count);
+		if(first_index == FreeListAllocator::INVALID_OFFSET) {
+			pages_[i].vertices.release(first_word, word_count);
+			continue;
+		}
+
+		range.page = i;
+		range.first_index = first_index;
+	}
+
+	// No page has room, start a new one large enough for this mesh
+	if(range.page < 0) {
+		GLsizei page_words = page_vertices_ * getVertexWords(VERTEX_FORMAT_FLOAT3);
+		range.page = createPage(word_count > page_words ? word_count : page_words,
+								index_count > page_indices_ ? index_count : page_indices_);
+		first_word = pages_[range.page].vertices.allocate(word_count, stride);
+		range.first_index = pages_[range.page].indices.allocate(index_count);
+	}
+	range.first_word = first_word;
+	range.base_vertex = first_word / stride;
+
+	MeshHandle handle;
+	if(!free_handles_.empty()) {
+		handle = free_handles_.back();
+		free_handles_.pop_back();
+		ranges_[handle] = range;
+		references_[handle] = 1;
+	} else {
+		handle = ranges_.size();
+		ranges_.push_back(range);
+		references_.push_back(1);
+	}
+
+	Page& page = pages_[range.page];
+	page.vertex_owners[range.first_word] = handle;
+	page.index_owners[range.first_index] = handle;
+	return handle;
+}
+
+MeshHandle MeshPool::add(Prism& prism, VertexFormat format) {
+	// Prism vertex counts are in floats, three per position
+	GLsizei vertex_count = prism.getVertexCount() / 3;
+	GLsizei index_count = prism.getIndexCount();
+	GLsizei stride = getVertexWords(format);
+	GLsizei word_count = vertex_count * stride;
+
+	MeshRange range = { -1, 0, vertex_count, 0, index_count, format, 0, { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f, 0.0f } };
+	std::vector<uint32_t> quantized;
+	const void* vertex_data = prism.getVertices();
+	if(format == VERTEX_FORMAT_UNORM16X3 && vertex_count > 0) {
+		quantizePositions(prism.getVertices(), vertex_count, range.position_scale, range.position_offset, quantized);
+		vertex_data = quantized.data();
+	}
+
+	MeshHandle handle = allocateRange(range, word_count, stride);
+	Page& page = pages_[range.page];
+	uploadToBuffer(page.vbo, (GLintptr)range.first_word * sizeof(uint32_t),
+				   (GLsizeiptr)word_count * sizeof(uint32_t), vertex_data);
+	uploadToBuffer(page.ebo, (GLintptr)range.first_index * sizeof(unsigned int),
+				   (GLsizeiptr)index_count * sizeof(unsigned int), prism.getIndices());
+	return handle;
+}
+
+MeshHandle MeshPool::reserve(GLsizei vertex_count, GLsizei index_count, VertexFormat format,
+							 const float* position_scale, const float* position_offset) {
+	GLsizei stride = getVertexWords(format);
+	MeshRange range = { -1, 0, vertex_count, 0, index_count, format, 0, { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f, 0.0f } };
+	for(int axis = 0; axis < 3 && format == VERTEX_FORMAT_UNORM16X3; axis++) {
+		range.position_scale[axis] = position_scale[axis];
+		range.position_offset[axis] = position_offset[axis];
+	}
+	return allocateRange(range, vertex_count * stride, stride);
+}
+
+void MeshPool::copyVertices(MeshHandle handle, GLuint source, GLintptr source_offset, GLintptr offset, GLsizeiptr size) {
+	// Looked up on every call, the range may have been compacted since the last slice
+	const MeshRange& range = ranges_[handle];
+	GLintptr destination = (GLintptr)range.first_word * sizeof(uint32_t) + offset;
+	copyBetweenBuffers(source, source_offset, pages_[range.page].vbo, destination, size);
+}
+
+void MeshPool::copyIndices(MeshHandle handle, GLuint source, GLintptr source_offset, GLintptr offset, GLsizeiptr size) {
+	const MeshRange& range = ranges_[handle];
+	GLintptr destination = (GLintptr)range.first_index * sizeof(unsigned int) + offset;
+	copyBetweenBuffers(source, source_offset, pages_[range.page].ebo, destination, size);
+}
+
+void MeshPool::retain(MeshHandle handle) {
+	references_[handle]++;
+}
+
+void MeshPool::remove(MeshHandle handle) {
+	if(--references_[handle] > 0) return;
+
+	MeshRange& range = ranges_[handle];
+	Page& page = pages_[range.page];
+
+	page.vertices.release(range.first_word, range.vertex_count * getVertexWords(range.format));
+	page.indices.release(range.first_index, range.index_count);
+	page.vertex_owners.erase(range.first_word);
+	page.index_owners.erase(range.first_index);
+
+	range.page = -1;
+	RetiredHandle retired = { handle, frame_ };
+	retired_.push_back(retired);
+}
+
+void MeshPool::endFrame() {
+	frame_++;
+	while(!retired_.empty() && frame_ - retired_.front().frame >= (uint64_t)retire_frames_) {
+		free_handles_.push_back(retired_.front().handle);
+		retired_.pop_front();
+	}
+}
+
+const MeshRange& MeshPool::getRange(MeshHandle handle) {
+	return ranges_[handle];
+}
+
+GLsizeiptr MeshPool::compactVertices(Page& page, GLsizeiptr byte_budget) {
+	if(page.vertices.isCompact()) return 0;
+
+	std::map<long, MeshHandle>::reverse_iterator it;
+	for(it = page.vertex_owners.rbegin(); it != page.vertex_owners.rend(); ++it) {
+		MeshRange& range = ranges_[it->second];
+		GLsizei stride = getVertexWords(range.format);
+		long words = range.vertex_count * stride;
+		GLsizeiptr size = (GLsizeiptr)words * sizeof(uint32_t);
+		if(size > byte_budget) continue;
+
+		long offset = it->first;
+		if(page.vertices.findHole(words, offset, stride) == FreeListAllocator::INVALID_OFFSET) continue;
+
+		long destination = page.vertices.allocate(words, stride);
+		copyWithinBuffer(page.vbo, offset * sizeof(uint32_t), destination * sizeof(uint32_t), size);
+		page.vertices.release(offset, words);
+
+		MeshHandle handle = it->second;
+		page.vertex_owners.erase(offset);
+		page.vertex_owners[destination] = handle;
+		range.first_word = destination;
+		range.base_vertex = destination / stride;
+		return size;
+	}
+	return 0;
+}
+
+GLsizeiptr MeshPool::compactIndices(Page& page, GLsizeiptr byte_budget) {
+	if(page.indices.isCompact()) return 0;
+
+	std::map<long, MeshHandle>::reverse_iterator it;
+	for(it = page.index_owners.rbegin(); it != page.index_owners.rend(); ++it) {
+		MeshRange& range = ranges_[it->second];
+		GLsizeiptr size = (GLsizeiptr)range.index_count * sizeof(unsigned int);
+		if(size > byte_budget) continue;
+
+		long offset = it->first;
+		if(page.indices.findHole(range.index_count, offset) == FreeListAllocator::INVALID_OFFSET) continue;
+
+		// Indices are relative to base_vertex, so they move without rewriting
+		long destination = page.indices.allocate(range.index_count);
+		copyWithinBuffer(page.ebo, offset * sizeof(unsigned int), destination * sizeof(unsigned int), size);
+		page.indices.release(offset, range.index_count);
+
+		MeshHandle handle = it->second;
+		page.index_owners.erase(offset);
+		page.index_owners[destination] = handle;
+		range.first_index = destination;
+		return size;
+	}
+	return 0;
+}
+
+void MeshPool::defragment(GLsizeiptr byte_budget) {
+	// Draws already submitted read the old location, later ones the new one,
+	// because the copies are ordered with the rest of the command stream
+	for(size_t i = 0; i < pages_.size() && byte_budget > 0; i++) {
+		Page& page = pages_[i];
+		GLsizeiptr moved = 1;
+		while(moved > 0 && byte_budget > 0) {
+			moved = compactVertices(page, byte_budget);
+			moved += compactIndices(page, byte_budget - moved);
+			byte_budget -= moved;
+		}
+	}
+}
+
+int MeshPool::getPageCount() {
+	return pages_.size();
+}
+
+GLuint MeshPool::getVertexArray(int page, VertexFormat format) {
+	return format == VERTEX_FORMAT_UNORM16X3 ? pages_[page].quantized_vao : pages_[page].vao;
+}
+
+GLuint MeshPool::getVertexBuffer(int page) {
+	return pages_[page].vbo;
+}
+
+GLuint MeshPool::getIndexBuffer(int page) {
+	return pages_[page].ebo;
+}
+
+void MeshPool::destroy() {
+	for(size_t i = 0; i < pages_.size(); i++) {
+		gl_state.forgetVertexArray(pages_[i].vao);
+		gl_state.forgetVertexArray(pages_[i].quantized_vao);
+		gl_state.forgetBuffer(pages_[i].vbo);
+		gl_state.forgetBuffer(pages_[i].ebo);
+		glDeleteVertexArrays(1, &pages_[i].vao);
+		glDeleteVertexArrays(1, &pages_[i].quantized_vao);
+		glDeleteBuffers(1, &pages_[i].vbo);
+		glDeleteBuffers(1, &pages_[i].ebo);
+	}
+	pages_.clear();
+	ranges_.clear();
+	references_.clear();
+	free_handles_.clear();
+	retired_.clear();
+}
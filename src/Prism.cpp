@@ -3,6 +3,15 @@
 Prism::Prism(float* vertices, int vertex_count, unsigned int* indices, int index_count)
 	: vertices_(vertices), vertex_count_(vertex_count), indices_(indices), index_count_(index_count) {}
 
+Prism::Prism(std::vector<float> vertices, std::vector<unsigned int> indices)
+	: owned_vertices_(std::make_shared<std::vector<float>>(std::move(vertices))),
+	  owned_indices_(std::make_shared<std::vector<unsigned int>>(std::move(indices))) {
+	vertices_ = owned_vertices_->data();
+	vertex_count_ = owned_vertices_->size();
+	indices_ = owned_indices_->data();
+	index_count_ = owned_indices_->size();
+}
+
 float* Prism::getVertices() {
 	return vertices_;
 }
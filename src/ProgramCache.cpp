@@ -0,0 +1,142 @@
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include "ProgramCache.h"
+
+#define PROGRAM_CACHE_MAGIC 0x42503344 // "D3PB"
+#define PROGRAM_CACHE_VERSION 1
+
+struct ProgramCacheHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t hash;
+	uint32_t format;
+	uint32_t length;
+};
+
+uint64_t hashBytes(const void* data, size_t size, uint64_t hash) {
+	// FNV-1a
+	const uint8_t* bytes = (const uint8_t*)data;
+	for(size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 0x100000001B3ull;
+	}
+	return hash;
+}
+
+static std::string glString(GLenum name) {
+	const GLubyte* value = glGetString(name);
+	return value ? (const char*)value : "";
+}
+
+ProgramCache::ProgramCache()
+	: supported_(false), hit_count_(0), miss_count_(0) {}
+
+void ProgramCache::initialize(const std::string& directory) {
+	directory_ = directory;
+	driver_ = glString(GL_VENDOR) + "\n" + glString(GL_RENDERER) + "\n" + glString(GL_VERSION);
+
+	// Program binaries are core since 4.1, but drivers may expose no formats
+	GLint format_count = 0;
+	if(GLAD_GL_VERSION_4_1) glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+	supported_ = format_count > 0;
+
+	std::error_code error;
+	if(supported_) std::filesystem::create_directories(directory_, error);
+	if(error) supported_ = false;
+}
+
+bool ProgramCache::isSupported() {
+	return supported_;
+}
+
+uint64_t ProgramCache::makeKey(const std::string& vertex_source, const std::string& fragment_source,
+							   const std::string& geometry_source) {
+	uint64_t hash = 0xCBF29CE484222325ull;
+	hash = hashBytes(driver_.data(), driver_.size() + 1, hash);
+	hash = hashBytes(vertex_source.data(), vertex_source.size() + 1, hash);
+	hash = hashBytes(fragment_source.data(), fragment_source.size() + 1, hash);
+	hash = hashBytes(geometry_source.data(), geometry_source.size() + 1, hash);
+	return hash;
+}
+
+std::string ProgramCache::entryPath(uint64_t key) {
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+	return directory_ + "/" + name;
+}
+
+bool ProgramCache::load(GLuint program, uint64_t key) {
+	if(!supported_) return false;
+
+	std::string path = entryPath(key);
+	std::ifstream file(path, std::ios::binary);
+	if(!file) {
+		miss_count_++;
+		return false;
+	}
+
+	ProgramCacheHeader header;
+	std::vector<char> binary;
+	bool valid = (bool)file.read((char*)&header, sizeof(header)) &&
+				 header.magic == PROGRAM_CACHE_MAGIC && header.version == PROGRAM_CACHE_VERSION &&
+				 header.hash == key;
+	if(valid) {
+		binary.resize(header.length);
+		valid = (bool)file.read(binary.data(), header.length);
+	}
+	file.close();
+
+	GLint linked = GL_FALSE;
+	if(valid) {
+		glProgramBinary(program, header.format, binary.data(), header.length);
+		glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	}
+
+	// Corrupt, truncated or rejected by the driver, rebuild from source
+	if(!linked) {
+		std::error_code error;
+		std::filesystem::remove(path, error);
+		miss_count_++;
+		return false;
+	}
+
+	hit_count_++;
+	return true;
+}
+
+void ProgramCache::store(GLuint program, uint64_t key) {
+	if(!supported_) return;
+
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if(length <= 0) return;
+
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	glGetProgramBinary(program, length, &length, &format, binary.data());
+
+	ProgramCacheHeader header = { PROGRAM_CACHE_MAGIC, PROGRAM_CACHE_VERSION, key, format, (uint32_t)length };
+
+	// Write to a temporary file first so a crash never leaves a torn entry
+	std::string path = entryPath(key);
+	std::string temporary = path + ".tmp";
+	std::ofstream file(temporary, std::ios::binary);
+	file.write((const char*)&header, sizeof(header));
+	file.write(binary.data(), length);
+	file.close();
+
+	std::error_code error;
+	if(file) std::filesystem::rename(temporary, path, error);
+	else std::filesystem::remove(temporary, error);
+}
+
+int ProgramCache::getHitCount() {
+	return hit_count_;
+}
+
+int ProgramCache::getMissCount() {
+	return miss_count_;
+}
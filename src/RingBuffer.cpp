@@ -0,0 +1,104 @@
+#include <iostream>
+#include "GLStateCache.h"
+#include "RingBuffer.h"
+
+RingBuffer::RingBuffer(GLsizeiptr frame_size)
+	: frame_size_(frame_size), buffer_(0), mapped_(nullptr), persistent_(false),
+	  fences_(), frame_(0), head_(0), flushed_(0) {}
+
+void RingBuffer::initialize() {
+	GLsizeiptr total_size = frame_size_ * FRAME_COUNT;
+	persistent_ = GLAD_GL_VERSION_4_4;
+
+	glGenBuffers(1, &buffer_);
+	gl_state.bindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+
+	if(persistent_) {
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_COPY_WRITE_BUFFER, total_size, nullptr, flags);
+		mapped_ = (uint8_t*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, total_size, flags);
+	} else {
+		glBufferData(GL_COPY_WRITE_BUFFER, total_size, nullptr, GL_STREAM_DRAW);
+		staging_.resize(total_size);
+		mapped_ = staging_.data();
+	}
+}
+
+void RingBuffer::beginFrame() {
+	// Wait until the GPU has consumed the data written three frames ago
+	GLsync fence = fences_[frame_];
+	if(fence) {
+		GLenum result = glClientWaitSync(fence, 0, 0);
+		while(result == GL_TIMEOUT_EXPIRED)
+			result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+		glDeleteSync(fence);
+		fences_[frame_] = nullptr;
+	}
+	head_ = 0;
+	flushed_ = 0;
+}
+
+RingAllocation RingBuffer::allocate(GLsizeiptr size, GLsizeiptr alignment) {
+	// Align the absolute offset so callers can turn it into an element index
+	GLintptr base = frame_ * frame_size_;
+	GLintptr offset = (base + head_ + alignment - 1) / alignment * alignment;
+
+	if(offset + size > base + frame_size_) {
+		std::cerr << "Ring buffer frame region exhausted (" << size << " bytes requested)" << std::endl;
+		RingAllocation failed = { nullptr, 0 };
+		return failed;
+	}
+
+	head_ = offset + size - base;
+	RingAllocation allocation = { mapped_ + offset, offset };
+	return allocation;
+}
+
+void RingBuffer::flush() {
+	// Coherent mappings are visible to the GPU without any call
+	if(persistent_ || flushed_ == head_) return;
+
+	GLintptr base = frame_ * frame_size_;
+	gl_state.bindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, base + flushed_, head_ - flushed_, mapped_ + base + flushed_);
+	flushed_ = head_;
+}
+
+void RingBuffer::endFrame() {
+	fences_[frame_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	frame_ = (frame_ + 1) % FRAME_COUNT;
+}
+
+void RingBuffer::resize(GLsizeiptr frame_size) {
+	// GL keeps a deleted buffer alive until the GPU is done with it, so the
+	// frames still in flight need no wait
+	destroy();
+	frame_size_ = frame_size;
+	frame_ = 0;
+	head_ = 0;
+	flushed_ = 0;
+	initialize();
+}
+
+GLsizeiptr RingBuffer::getFrameSize() {
+	return frame_size_;
+}
+
+GLuint RingBuffer::getBuffer() {
+	return buffer_;
+}
+
+void RingBuffer::destroy() {
+	for(int i = 0; i < FRAME_COUNT; i++) {
+		if(fences_[i]) glDeleteSync(fences_[i]);
+		fences_[i] = nullptr;
+	}
+
+	if(persistent_) {
+		gl_state.bindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+		glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+	}
+	gl_state.forgetBuffer(buffer_);
+	glDeleteBuffers(1, &buffer_);
+	mapped_ = nullptr;
+}
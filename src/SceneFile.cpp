@@ -0,0 +1,333 @@
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+#include "SceneFile.h"
+
+SceneFile::SceneFile()
+	: meshes_(nullptr), vertices_(nullptr), indices_(nullptr), lods_(nullptr), meshlets_(nullptr), mesh_count_(0) {}
+
+const uint8_t* SceneFile::findSection(SceneSectionType type, size_t record_size, size_t& count) {
+	const uint8_t* data = (const uint8_t*)file_.getData();
+	SceneFileHeader header;
+	memcpy(&header, data, sizeof(header));
+
+	count = 0;
+	for(uint32_t i = 0; i < header.section_count; i++) {
+		SceneSection section;
+		memcpy(&section, data + sizeof(header) + i * sizeof(section), sizeof(section));
+		if(section.type != type) continue;
+
+		bool valid = section.offset % SCENE_SECTION_ALIGNMENT == 0 && section.offset <= file_.getSize() &&
+					 section.size <= file_.getSize() - section.offset && section.size % record_size == 0;
+		if(!valid) return nullptr;
+		count = section.size / record_size;
+		return data + section.offset;
+	}
+	return nullptr;
+}
+
+static bool indicesInRange(const uint32_t* indices, uint64_t count, uint32_t vertex_count) {
+	for(uint64_t i = 0; i < count; i++)
+		if(indices[i] >= vertex_count) return false;
+	return true;
+}
+
+bool SceneFile::open(const std::string& path) {
+	close();
+	if(!file_.open(path)) return false;
+
+	const char* error = nullptr;
+	SceneFileHeader header;
+	size_t size = file_.getSize();
+	if(size < sizeof(header)) {
+		error = "truncated header";
+	} else {
+		memcpy(&header, file_.getData(), sizeof(header));
+		if(memcmp(header.magic, SCENE_FILE_MAGIC, 4) != 0) error = "not a scene file";
+		else if(header.version != SCENE_FILE_VERSION) error = "unsupported version";
+		else if(header.file_size != size) error = "truncated";
+		else if(header.section_count > (size - sizeof(header)) / sizeof(SceneSection)) error = "truncated section table";
+	}
+
+	size_t vertex_count = 0, index_count = 0, lod_count = 0, meshlet_count = 0;
+	if(!error) {
+		meshes_ = (const SceneMeshRecord*)findSection(SCENE_SECTION_MESHES, sizeof(SceneMeshRecord), mesh_count_);
+		vertices_ = (const float*)findSection(SCENE_SECTION_VERTICES, 3 * sizeof(float), vertex_count);
+		indices_ = (const uint32_t*)findSection(SCENE_SECTION_INDICES, sizeof(uint32_t), index_count);
+		lods_ = (const SceneLodRecord*)findSection(SCENE_SECTION_LODS, sizeof(SceneLodRecord), lod_count);
+		meshlets_ = (const SceneMeshletRecord*)findSection(SCENE_SECTION_MESHLETS, sizeof(SceneMeshletRecord), meshlet_count);
+		if(!meshes_ || !vertices_ || !indices_ || !lods_) error = "missing or invalid section";
+	}
+
+	// Checked once here so nothing later has to bounds check the mapping.
+	// Out of range indices would read other meshes' vertices in the page.
+	for(size_t i = 0; i < mesh_count_ && !error; i++) {
+		const SceneMeshRecord& mesh = meshes_[i];
+		if(mesh.first_vertex > vertex_count || mesh.vertex_count > vertex_count - mesh.first_vertex ||
+		   mesh.first_index > index_count || mesh.index_count > index_count - mesh.first_index ||
+		   mesh.lod_count == 0 || mesh.first_lod > lod_count || mesh.lod_count > lod_count - mesh.first_lod ||
+		   mesh.first_meshlet > meshlet_count || mesh.meshlet_count > meshlet_count - mesh.first_meshlet) {
+			error = "mesh range out of bounds";
+			break;
+		}
+		if(!indicesInRange(indices_ + mesh.first_index, mesh.index_count, mesh.vertex_count)) {
+			error = "index out of range";
+			break;
+		}
+		for(uint32_t l = 0; l < mesh.lod_count && !error; l++) {
+			const SceneLodRecord& lod = lods_[mesh.first_lod + l];
+			uint64_t end = mesh.first_index + (uint64_t)lod.first_index + lod.index_count;
+			if(end > index_count) error = "LOD range out of bounds";
+			else if(!indicesInRange(indices_ + end - lod.index_count, lod.index_count, mesh.vertex_count))
+				error = "LOD index out of range";
+		}
+		for(uint32_t m = 0; m < mesh.meshlet_count && !error; m++) {
+			const SceneMeshletRecord& meshlet = meshlets_[mesh.first_meshlet + m];
+			if(meshlet.first_index + (uint64_t)meshlet.triangle_count * 3 > mesh.index_count)
+				error = "meshlet range out of bounds";
+		}
+	}
+
+	if(error) {
+		std::cerr << "Invalid scene file " << path << ": " << error << std::endl;
+		close();
+		return false;
+	}
+	return true;
+}
+
+int SceneFile::getMeshCount() {
+	return mesh_count_;
+}
+
+const SceneMeshRecord& SceneFile::getMesh(int mesh) {
+	return meshes_[mesh];
+}
+
+Prism SceneFile::getPrism(int mesh) {
+	// The mapping is read-only, Prism only reads through these pointers
+	const SceneMeshRecord& record = meshes_[mesh];
+	float* vertices = (float*)(vertices_ + record.first_vertex * 3);
+	unsigned int* indices = (unsigned int*)(indices_ + record.first_index);
+	return Prism(vertices, record.vertex_count * 3, indices, record.index_count);
+}
+
+const SceneLodRecord* SceneFile::getLods(int mesh) {
+	return lods_ + meshes_[mesh].first_lod;
+}
+
+const SceneMeshletRecord* SceneFile::getMeshlets(int mesh) {
+	return meshlets_ + meshes_[mesh].first_meshlet;
+}
+
+size_t SceneFile::getSize() {
+	return file_.getSize();
+}
+
+void SceneFile::close() {
+	file_.close();
+	meshes_ = nullptr;
+	vertices_ = nullptr;
+	indices_ = nullptr;
+	lods_ = nullptr;
+	meshlets_ = nullptr;
+	mesh_count_ = 0;
+}
+
+// Writing
+
+// Coarser levels merge all vertices in a grid cell into the first one seen
+// there and drop the triangles that collapse. Levels stop once one no longer
+// removes a fifth of the triangles of the level before.
+static void buildLods(const ImportedMesh& mesh, const SceneMeshRecord& record, std::vector<uint32_t>& indices,
+					  std::vector<SceneLodRecord>& lods) {
+	size_t first_index = indices.size();
+	SceneLodRecord base = { 0, (uint32_t)mesh.indices.size(), 0.0f, 0 };
+	lods.push_back(base);
+	indices.insert(indices.end(), mesh.indices.begin(), mesh.indices.end());
+
+	float extent = 0.0f;
+	for(int axis = 0; axis < 3; axis++)
+		extent = fmaxf(extent, record.bounds_max[axis] - record.bounds_min[axis]);
+	if(extent <= 0.0f) return;
+
+	size_t vertex_count = mesh.vertices.size() / 3;
+	std::vector<uint32_t> representative(vertex_count);
+	std::vector<uint32_t> level;
+	uint32_t previous_count = base.index_count;
+	for(int resolution = 64; resolution >= 16 && lods.size() < SCENE_MAX_LODS; resolution /= 2) {
+		float cell_size = extent / resolution;
+		std::unordered_map<uint64_t, uint32_t> cells;
+		for(size_t v = 0; v < vertex_count; v++) {
+			uint64_t key = 0;
+			for(int axis = 0; axis < 3; axis++) {
+				uint64_t cell = (uint64_t)((mesh.vertices[v * 3 + axis] - record.bounds_min[axis]) / cell_size);
+				key |= (cell & 0x1FFFFF) << (axis * 21);
+			}
+			representative[v] = cells.emplace(key, (uint32_t)v).first->second;
+		}
+
+		level.clear();
+		for(size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+			uint32_t a = representative[mesh.indices[i]];
+			uint32_t b = representative[mesh.indices[i + 1]];
+			uint32_t c = representative[mesh.indices[i + 2]];
+			if(a == b || b == c || a == c) continue;
+			level.push_back(a);
+			level.push_back(b);
+			level.push_back(c);
+		}
+		if(level.empty() || level.size() > previous_count * 4 / 5) break;
+
+		SceneLodRecord lod = { (uint32_t)(indices.size() - first_index), (uint32_t)level.size(), cell_size, 0 };
+		lods.push_back(lod);
+		indices.insert(indices.end(), level.begin(), level.end());
+		previous_count = level.size();
+	}
+}
+
+static void finishMeshlet(const ImportedMesh& mesh, const std::vector<uint32_t>& vertices, SceneMeshletRecord& meshlet) {
+	float low[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float high[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for(size_t i = 0; i < vertices.size(); i++) {
+		for(int axis = 0; axis < 3; axis++) {
+			low[axis] = fminf(low[axis], mesh.vertices[vertices[i] * 3 + axis]);
+			high[axis] = fmaxf(high[axis], mesh.vertices[vertices[i] * 3 + axis]);
+		}
+	}
+
+	float radius_squared = 0.0f;
+	for(int axis = 0; axis < 3; axis++)
+		meshlet.center[axis] = (low[axis] + high[axis]) * 0.5f;
+	for(size_t i = 0; i < vertices.size(); i++) {
+		float distance_squared = 0.0f;
+		for(int axis = 0; axis < 3; axis++) {
+			float delta = mesh.vertices[vertices[i] * 3 + axis] - meshlet.center[axis];
+			distance_squared += delta * delta;
+		}
+		radius_squared = fmaxf(radius_squared, distance_squared);
+	}
+	meshlet.radius = sqrtf(radius_squared);
+	meshlet.vertex_count = vertices.size();
+}
+
+// Greedy split of LOD 0 in index order, no triangles are reordered
+static void buildMeshlets(const ImportedMesh& mesh, std::vector<SceneMeshletRecord>& meshlets) {
+	std::vector<uint32_t> vertices;
+	SceneMeshletRecord meshlet = {};
+	for(size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+		uint32_t added[3];
+		int added_count = 0;
+		for(int corner = 0; corner < 3; corner++) {
+			uint32_t vertex = mesh.indices[i + corner];
+			bool known = false;
+			for(size_t k = 0; k < vertices.size() && !known; k++)
+				known = vertices[k] == vertex;
+			for(int k = 0; k < added_count && !known; k++)
+				known = added[k] == vertex;
+			if(!known) added[added_count++] = vertex;
+		}
+
+		if(vertices.size() + added_count > SCENE_MESHLET_VERTICES || meshlet.triangle_count == SCENE_MESHLET_TRIANGLES) {
+			finishMeshlet(mesh, vertices, meshlet);
+			meshlets.push_back(meshlet);
+			meshlet = SceneMeshletRecord();
+			meshlet.first_index = i;
+			vertices.clear();
+			i -= 3; // Start the new meshlet with this triangle
+			continue;
+		}
+
+		vertices.insert(vertices.end(), added, added + added_count);
+		meshlet.triangle_count++;
+	}
+
+	if(meshlet.triangle_count > 0) {
+		finishMeshlet(mesh, vertices, meshlet);
+		meshlets.push_back(meshlet);
+	}
+}
+
+static void writeSection(std::ofstream& file, std::vector<SceneSection>& table, SceneSectionType type,
+						 const void* data, size_t size) {
+	static const char padding[SCENE_SECTION_ALIGNMENT] = {};
+	uint64_t offset = file.tellp();
+	uint64_t aligned = (offset + SCENE_SECTION_ALIGNMENT - 1) / SCENE_SECTION_ALIGNMENT * SCENE_SECTION_ALIGNMENT;
+	file.write(padding, aligned - offset);
+	file.write((const char*)data, size);
+
+	SceneSection section = { type, 0, aligned, size };
+	table.push_back(section);
+}
+
+bool writeSceneFile(const std::string& path, const std::vector<ImportedMesh>& meshes) {
+	std::vector<SceneMeshRecord> records;
+	std::vector<float> vertices;
+	std::vector<uint32_t> indices;
+	std::vector<SceneLodRecord> lods;
+	std::vector<SceneMeshletRecord> meshlets;
+
+	for(size_t m = 0; m < meshes.size(); m++) {
+		const ImportedMesh& mesh = meshes[m];
+		SceneMeshRecord record = {};
+		record.first_vertex = vertices.size() / 3;
+		record.first_index = indices.size();
+		record.vertex_count = mesh.vertices.size() / 3;
+		record.index_count = mesh.indices.size();
+
+		for(int axis = 0; axis < 3; axis++) {
+			record.bounds_min[axis] = FLT_MAX;
+			record.bounds_max[axis] = -FLT_MAX;
+		}
+		for(size_t v = 0; v < mesh.vertices.size(); v++) {
+			record.bounds_min[v % 3] = fminf(record.bounds_min[v % 3], mesh.vertices[v]);
+			record.bounds_max[v % 3] = fmaxf(record.bounds_max[v % 3], mesh.vertices[v]);
+		}
+
+		record.first_lod = lods.size();
+		buildLods(mesh, record, indices, lods);
+		record.lod_count = lods.size() - record.first_lod;
+
+		record.first_meshlet = meshlets.size();
+		buildMeshlets(mesh, meshlets);
+		record.meshlet_count = meshlets.size() - record.first_meshlet;
+
+		vertices.insert(vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+		records.push_back(record);
+	}
+
+	// Header and table are rewritten once the section offsets are known.
+	// Written to a temporary file first so a failed write never leaves a torn scene.
+	std::string temporary = path + ".tmp";
+	std::ofstream file(temporary, std::ios::binary);
+	SceneFileHeader header = { {}, SCENE_FILE_VERSION, 5, 0, 0 };
+	memcpy(header.magic, SCENE_FILE_MAGIC, sizeof(header.magic));
+	std::vector<SceneSection> table;
+	file.write((const char*)&header, sizeof(header));
+	file.write(std::string(header.section_count * sizeof(SceneSection), '\0').data(), header.section_count * sizeof(SceneSection));
+
+	writeSection(file, table, SCENE_SECTION_MESHES, records.data(), records.size() * sizeof(SceneMeshRecord));
+	writeSection(file, table, SCENE_SECTION_VERTICES, vertices.data(), vertices.size() * sizeof(float));
+	writeSection(file, table, SCENE_SECTION_INDICES, indices.data(), indices.size() * sizeof(uint32_t));
+	writeSection(file, table, SCENE_SECTION_LODS, lods.data(), lods.size() * sizeof(SceneLodRecord));
+	writeSection(file, table, SCENE_SECTION_MESHLETS, meshlets.data(), meshlets.size() * sizeof(SceneMeshletRecord));
+
+	header.file_size = file.tellp();
+	file.seekp(0);
+	file.write((const char*)&header, sizeof(header));
+	file.write((const char*)table.data(), table.size() * sizeof(SceneSection));
+	file.close();
+
+	std::error_code error;
+	if(!file) {
+		std::filesystem::remove(temporary, error);
+		std::cerr << "Failed to write " << path << std::endl;
+		return false;
+	}
+	std::filesystem::rename(temporary, path, error);
+	return !error;
+}
@@ -0,0 +1,150 @@
+#include <algorithm>
+#include "SceneGraph.h"
+
+static const glm::mat4 IDENTITY(1.0f);
+
+SceneGraph::SceneGraph() {}
+
+SceneNode SceneGraph::create(SceneNode parent) {
+	int parent_index = -1;
+	if(parent != INVALID_SCENE_NODE) {
+		parent_index = getIndex(parent);
+		if(parent_index < 0) return INVALID_SCENE_NODE;
+	}
+
+	uint32_t slot;
+	if(!free_slots_.empty()) {
+		slot = free_slots_.back();
+		free_slots_.pop_back();
+	} else {
+		if(slot_to_dense_.size() >= SCENE_NODE_MAX_COUNT) return INVALID_SCENE_NODE;
+		slot = slot_to_dense_.size();
+		slot_to_dense_.push_back(0);
+		generations_.push_back(0);
+	}
+	SceneNode node = slot | ((SceneNode)generations_[slot] << SCENE_NODE_INDEX_BITS);
+
+	// Last in the parent's subtree, roots go to the very end
+	int index = parent_index < 0 ? (int)parents_.size() : parent_index + subtree_sizes_[parent_index];
+	parents_.insert(parents_.begin() + index, parent_index);
+	subtree_sizes_.insert(subtree_sizes_.begin() + index, 1);
+	local_.insert(local_.begin() + index, IDENTITY);
+	world_.insert(world_.begin() + index, IDENTITY);
+	dirty_.insert(dirty_.begin() + index, 1);
+	dense_to_handle_.insert(dense_to_handle_.begin() + index, node);
+	dirty_nodes_.push_back(node);
+
+	// Everything behind the new node moved up by one
+	for(size_t i = index + 1; i < parents_.size(); i++) {
+		slot_to_dense_[(uint32_t)dense_to_handle_[i]] = i;
+		if(parents_[i] >= index) parents_[i]++;
+	}
+	slot_to_dense_[slot] = index;
+	for(int ancestor = parent_index; ancestor >= 0; ancestor = parents_[ancestor])
+		subtree_sizes_[ancestor]++;
+	return node;
+}
+
+void SceneGraph::destroy(SceneNode node) {
+	int index = getIndex(node);
+	if(index < 0) return;
+	int count = subtree_sizes_[index];
+	int end = index + count;
+
+	for(int i = index; i < end; i++) {
+		uint32_t slot = (uint32_t)dense_to_handle_[i];
+		generations_[slot]++;
+		free_slots_.push_back(slot);
+	}
+	for(int ancestor = parents_[index]; ancestor >= 0; ancestor = parents_[ancestor])
+		subtree_sizes_[ancestor] -= count;
+
+	parents_.erase(parents_.begin() + index, parents_.begin() + end);
+	subtree_sizes_.erase(subtree_sizes_.begin() + index, subtree_sizes_.begin() + end);
+	local_.erase(local_.begin() + index, local_.begin() + end);
+	world_.erase(world_.begin() + index, world_.begin() + end);
+	dirty_.erase(dirty_.begin() + index, dirty_.begin() + end);
+	dense_to_handle_.erase(dense_to_handle_.begin() + index, dense_to_handle_.begin() + end);
+
+	// Parents of the nodes behind the hole are before it or moved with them
+	for(size_t i = index; i < parents_.size(); i++) {
+		slot_to_dense_[(uint32_t)dense_to_handle_[i]] = i;
+		if(parents_[i] >= end) parents_[i] -= count;
+	}
+}
+
+bool SceneGraph::isAlive(SceneNode node) {
+	uint32_t slot = (uint32_t)node;
+	return node != INVALID_SCENE_NODE && slot < generations_.size() &&
+		   generations_[slot] == node >> SCENE_NODE_INDEX_BITS;
+}
+
+int SceneGraph::getIndex(SceneNode node) {
+	return isAlive(node) ? (int)slot_to_dense_[(uint32_t)node] : -1;
+}
+
+int SceneGraph::getCount() {
+	return parents_.size();
+}
+
+void SceneGraph::setLocalTransform(SceneNode node, const glm::mat4& transform) {
+	int index = getIndex(node);
+	if(index < 0) return;
+	local_[index] = transform;
+	if(dirty_[index]) return;
+	dirty_[index] = 1;
+	dirty_nodes_.push_back(node);
+}
+
+const glm::mat4& SceneGraph::getLocalTransform(SceneNode node) {
+	int index = getIndex(node);
+	return index < 0 ? IDENTITY : local_[index];
+}
+
+const glm::mat4& SceneGraph::getWorldTransform(SceneNode node) {
+	// Stale handles read as identity, so objects under a destroyed node stay put
+	int index = getIndex(node);
+	return index < 0 ? IDENTITY : world_[index];
+}
+
+glm::mat4 SceneGraph::resolveWorldTransform(SceneNode node) {
+	// Walks the local transforms up to the root, so it is current before
+	// update() has run for a new or changed node
+	int index = getIndex(node);
+	if(index < 0) return IDENTITY;
+	glm::mat4 world = local_[index];
+	for(int parent = parents_[index]; parent >= 0; parent = parents_[parent])
+		world = local_[parent] * world;
+	return world;
+}
+
+int SceneGraph::update() {
+	// Dirty nodes in array order, so ancestors come first and cover their
+	// dirty descendants. Destroyed nodes drop out here.
+	std::vector<int> dirty;
+	dirty.reserve(dirty_nodes_.size());
+	for(size_t i = 0; i < dirty_nodes_.size(); i++) {
+		int index = getIndex(dirty_nodes_[i]);
+		if(index >= 0) dirty.push_back(index);
+	}
+	dirty_nodes_.clear();
+	std::sort(dirty.begin(), dirty.end());
+
+	int updated = 0;
+	int covered = 0;
+	for(size_t d = 0; d < dirty.size(); d++) {
+		int begin = dirty[d];
+		if(begin < covered) continue;
+		covered = begin + subtree_sizes_[begin];
+
+		// The parent of the first node is outside the range and already
+		// current, every later node's parent is earlier in the range
+		for(int i = begin; i < covered; i++) {
+			int parent = parents_[i];
+			world_[i] = parent < 0 ? local_[i] : world_[parent] * local_[i];
+			dirty_[i] = 0;
+		}
+		updated += covered - begin;
+	}
+	return updated;
+}
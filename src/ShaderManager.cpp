@@ -0,0 +1,216 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include "ShaderManager.h"
+
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+static bool hasExtension(const char* name) {
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	for(GLint i = 0; i < count; i++) {
+		const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+		if(extension && strcmp(extension, name) == 0) return true;
+	}
+	return false;
+}
+
+static bool checkShader(GLuint shader, const std::string& name, const char* stage) {
+	GLint compiled = GL_FALSE;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+	if(compiled) return true;
+
+	char log[1024];
+	glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+	std::cerr << "Failed to compile " << stage << " shader for " << name << ":\n" << log << std::endl;
+	return false;
+}
+
+static const char* feature_defines[SHADER_FEATURE_COUNT] = {
+	"QUANTIZED_POSITIONS", "WIREFRAME", "LIGHTING", "VERTEX_PULLING", "DRAW_TABLES"
+};
+
+// Lowest GLSL version each feature compiles with, 0 for any.
+// VERTEX_PULLING and DRAW_TABLES read gl_BaseInstance, core only since 4.60.
+static const int feature_versions[SHADER_FEATURE_COUNT] = {
+	0, 0, 0, 460, 460
+};
+
+static std::string injectDefines(const char* source, uint32_t features) {
+	std::string defines;
+	int required_version = 0;
+	for(int i = 0; i < SHADER_FEATURE_COUNT; i++) {
+		if(!(features & (1u << i))) continue;
+		defines += std::string("#define ") + feature_defines[i] + " 1\n";
+		if(feature_versions[i] > required_version) required_version = feature_versions[i];
+	}
+
+	// Must follow #version, which has to be the first directive
+	std::string result = source;
+	size_t version = result.find("#version");
+	size_t line_end = version == std::string::npos ? std::string::npos : result.find('\n', version);
+	if(line_end == std::string::npos) return defines + result;
+
+	size_t number = result.find_first_of("0123456789", version);
+	size_t number_end = number == std::string::npos ? std::string::npos : result.find_first_not_of("0123456789", number);
+	if(number < line_end && number_end <= line_end && atoi(result.c_str() + number) < required_version)
+		result.replace(number, number_end - number, std::to_string(required_version));
+
+	line_end = result.find('\n', version);
+	return result.insert(line_end + 1, defines);
+}
+
+ShaderManager::ShaderManager(ProgramCache& cache)
+	: cache_(cache), parallel_(false), cache_enabled_(true), pending_count_(0) {}
+
+void ShaderManager::initialize(GLADloadproc load) {
+	// The KHR and ARB variants share the same tokens and entry point semantics
+	const char* entry_point = nullptr;
+	if(hasExtension("GL_KHR_parallel_shader_compile")) entry_point = "glMaxShaderCompilerThreadsKHR";
+	else if(hasExtension("GL_ARB_parallel_shader_compile")) entry_point = "glMaxShaderCompilerThreadsARB";
+	if(!entry_point) return;
+
+	PFNGLMAXSHADERCOMPILERTHREADSKHRPROC maxShaderCompilerThreads =
+		(PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)load(entry_point);
+	if(maxShaderCompilerThreads) maxShaderCompilerThreads(0xFFFFFFFF); // Let the driver decide
+	parallel_ = true;
+}
+
+ShaderHandle ShaderManager::request(const char* name, const char* vertex_source, const char* fragment_source,
+									const char* geometry_source) {
+	Program entry;
+	entry.name = name;
+	entry.vertex_source = vertex_source;
+	entry.fragment_source = fragment_source;
+	entry.geometry_source = geometry_source ? geometry_source : "";
+	entry.key = cache_.makeKey(entry.vertex_source, entry.fragment_source, entry.geometry_source);
+	entry.program = glCreateProgram();
+	entry.vertex_shader = 0;
+	entry.fragment_shader = 0;
+	entry.geometry_shader = 0;
+	entry.ready = false;
+
+	if(cache_enabled_ && cache_.load(entry.program, entry.key)) {
+		entry.ready = true;
+		programs_.push_back(entry);
+		return programs_.size() - 1;
+	}
+
+	// glProgramBinary may have left the program in a failed state
+	glDeleteProgram(entry.program);
+	entry.program = glCreateProgram();
+	if(cache_.isSupported()) glProgramParameteri(entry.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+	// None of these calls wait on the compiler; status queries would
+	const char* source = entry.vertex_source.c_str();
+	entry.vertex_shader = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(entry.vertex_shader, 1, &source, nullptr);
+	glCompileShader(entry.vertex_shader);
+
+	source = entry.fragment_source.c_str();
+	entry.fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(entry.fragment_shader, 1, &source, nullptr);
+	glCompileShader(entry.fragment_shader);
+
+	if(!entry.geometry_source.empty()) {
+		source = entry.geometry_source.c_str();
+		entry.geometry_shader = glCreateShader(GL_GEOMETRY_SHADER);
+		glShaderSource(entry.geometry_shader, 1, &source, nullptr);
+		glCompileShader(entry.geometry_shader);
+		glAttachShader(entry.program, entry.geometry_shader);
+	}
+
+	glAttachShader(entry.program, entry.vertex_shader);
+	glAttachShader(entry.program, entry.fragment_shader);
+	glLinkProgram(entry.program);
+
+	programs_.push_back(entry);
+	pending_count_++;
+	return programs_.size() - 1;
+}
+
+ShaderHandle ShaderManager::requestVariant(const char* name, const char* vertex_source, const char* fragment_source,
+											 uint32_t features, const char* geometry_source) {
+	std::pair<std::string, uint32_t> key(name, features);
+	std::map<std::pair<std::string, uint32_t>, ShaderHandle>::iterator existing = variants_.find(key);
+	if(existing != variants_.end()) return existing->second;
+
+	std::string vertex = injectDefines(vertex_source, features);
+	std::string fragment = injectDefines(fragment_source, features);
+	std::string geometry = geometry_source ? injectDefines(geometry_source, features) : "";
+	ShaderHandle handle = request(name, vertex.c_str(), fragment.c_str(), geometry_source ? geometry.c_str() : nullptr);
+	variants_[key] = handle;
+	return handle;
+}
+
+void ShaderManager::finish(Program& entry) {
+	GLint linked = GL_FALSE;
+	glGetProgramiv(entry.program, GL_LINK_STATUS, &linked);
+
+	if(linked) {
+		if(cache_enabled_) cache_.store(entry.program, entry.key);
+	} else {
+		checkShader(entry.vertex_shader, entry.name, "vertex");
+		checkShader(entry.fragment_shader, entry.name, "fragment");
+		if(entry.geometry_shader) checkShader(entry.geometry_shader, entry.name, "geometry");
+
+		char log[1024];
+		glGetProgramInfoLog(entry.program, sizeof(log), nullptr, log);
+		std::cerr << "Failed to link " << entry.name << ":\n" << log << std::endl;
+	}
+
+	glDetachShader(entry.program, entry.vertex_shader);
+	glDetachShader(entry.program, entry.fragment_shader);
+	glDeleteShader(entry.vertex_shader);
+	glDeleteShader(entry.fragment_shader);
+	if(entry.geometry_shader) {
+		glDetachShader(entry.program, entry.geometry_shader);
+		glDeleteShader(entry.geometry_shader);
+	}
+	entry.vertex_shader = 0;
+	entry.fragment_shader = 0;
+	entry.geometry_shader = 0;
+
+	entry.ready = true;
+	pending_count_--;
+}
+
+void ShaderManager::poll() {
+	// Without the extension any status query would block, so leave it to get()
+	if(!parallel_ || pending_count_ == 0) return;
+
+	for(Program& entry : programs_) {
+		if(entry.ready) continue;
+
+		GLint complete = GL_FALSE;
+		glGetProgramiv(entry.program, GL_COMPLETION_STATUS_KHR, &complete);
+		if(complete) finish(entry);
+	}
+}
+
+bool ShaderManager::isReady(ShaderHandle handle) {
+	return programs_[handle].ready;
+}
+
+GLuint ShaderManager::get(ShaderHandle handle) {
+	Program& entry = programs_[handle];
+	if(!entry.ready) finish(entry);
+	return entry.program;
+}
+
+int ShaderManager::getPendingCount() {
+	return pending_count_;
+}
+
+void ShaderManager::setCacheEnabled(bool enabled) {
+	cache_enabled_ = enabled;
+}
+
+void ShaderManager::destroy() {
+	for(Program& entry : programs_) {
+		if(!entry.ready) finish(entry);
+		glDeleteProgram(entry.program);
+	}
+	programs_.clear();
+	variants_.clear();
+}
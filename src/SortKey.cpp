@@ -0,0 +1,60 @@
+#include <cstring>
+#include "SortKey.h"
+
+static uint64_t packField(uint64_t key, uint32_t value, int bits) {
+	return (key << bits) | (value & ((1u << bits) - 1));
+}
+
+uint64_t makeSortKey(uint32_t pass, uint32_t program, uint32_t material, uint32_t vertex_array, float depth) {
+	if(depth < 0.0f) depth = 0.0f;
+	if(depth > 1.0f) depth = 1.0f;
+	uint32_t quantized_depth = (uint32_t)(depth * ((1u << SORT_KEY_DEPTH_BITS) - 1));
+
+	uint64_t key = 0;
+	key = packField(key, pass, SORT_KEY_PASS_BITS);
+	key = packField(key, program, SORT_KEY_PROGRAM_BITS);
+	key = packField(key, material, SORT_KEY_MATERIAL_BITS);
+	key = packField(key, vertex_array, SORT_KEY_VERTEX_ARRAY_BITS);
+	key = packField(key, quantized_depth, SORT_KEY_DEPTH_BITS);
+	return key;
+}
+
+void radixSort(std::vector<SortItem>& items, std::vector<SortItem>& scratch) {
+	size_t count = items.size();
+	scratch.resize(count);
+
+	// Build every digit histogram in a single pass over the keys
+	uint32_t histograms[8][256];
+	memset(histograms, 0, sizeof(histograms));
+	for(size_t i = 0; i < count; i++) {
+		uint64_t key = items[i].key;
+		for(int digit = 0; digit < 8; digit++)
+			histograms[digit][(key >> (digit * 8)) & 0xFF]++;
+	}
+
+	SortItem* source = items.data();
+	SortItem* destination = scratch.data();
+	for(int digit = 0; digit < 8; digit++) {
+		uint32_t* histogram = histograms[digit];
+		int shift = digit * 8;
+
+		// Every key shares this digit, the pass would not move anything
+		if(count == 0 || histogram[(source[0].key >> shift) & 0xFF] == count) continue;
+
+		uint32_t offsets[256];
+		uint32_t sum = 0;
+		for(int bucket = 0; bucket < 256; bucket++) {
+			offsets[bucket] = sum;
+			sum += histogram[bucket];
+		}
+
+		for(size_t i = 0; i < count; i++)
+			destination[offsets[(source[i].key >> shift) & 0xFF]++] = source[i];
+
+		SortItem* swap = source;
+		source = destination;
+		destination = swap;
+	}
+
+	if(source != items.data()) items.swap(scratch);
+}
@@ -0,0 +1,296 @@
+#include "TransformKernels.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TRANSFORM_KERNELS_X86
+#include <immintrin.h>
+#define TARGET_SSE __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+#endif
+
+static void composeScalar(const TransformArrays& t, int begin, int end, glm::mat4* world, const glm::mat4* vp,
+						  glm::mat4* mvp) {
+	for(int i = begin; i < end; i++) {
+		float qx = t.rotation_x[i], qy = t.rotation_y[i], qz = t.rotation_z[i], qw = t.rotation_w[i];
+		float xx = qx * qx, yy = qy * qy, zz = qz * qz;
+		float xy = qx * qy, xz = qx * qz, yz = qy * qz;
+		float wx = qw * qx, wy = qw * qy, wz = qw * qz;
+
+		float* m = &world[i][0][0];
+		m[0] = (1.0f - 2.0f * (yy + zz)) * t.scale_x[i];
+		m[1] = 2.0f * (xy + wz) * t.scale_x[i];
+		m[2] = 2.0f * (xz - wy) * t.scale_x[i];
+		m[3] = 0.0f;
+		m[4] = 2.0f * (xy - wz) * t.scale_y[i];
+		m[5] = (1.0f - 2.0f * (xx + zz)) * t.scale_y[i];
+		m[6] = 2.0f * (yz + wx) * t.scale_y[i];
+		m[7] = 0.0f;
+		m[8] = 2.0f * (xz + wy) * t.scale_z[i];
+		m[9] = 2.0f * (yz - wx) * t.scale_z[i];
+		m[10] = (1.0f - 2.0f * (xx + yy)) * t.scale_z[i];
+		m[11] = 0.0f;
+		m[12] = t.position_x[i];
+		m[13] = t.position_y[i];
+		m[14] = t.position_z[i];
+		m[15] = 1.0f;
+		if(!mvp) continue;
+
+		// The bottom row of the world matrix is 0 0 0 1
+		const float* p = &(*vp)[0][0];
+		float* out = &mvp[i][0][0];
+		for(int column = 0; column < 4; column++) {
+			const float* w = m + column * 4;
+			for(int row = 0; row < 4; row++)
+				out[column * 4 + row] = p[row] * w[0] + p[4 + row] * w[1] + p[8 + row] * w[2] + p[12 + row] * w[3];
+		}
+	}
+}
+
+#ifdef TRANSFORM_KERNELS_X86
+
+// Each kernel computes the 16 matrix elements of a group of objects as one
+// register per element. Transposing four registers within each 128-bit lane
+// then gives one matrix column of four objects per lane.
+
+TARGET_SSE static inline void storeColumnsSse(__m128 a, __m128 b, __m128 c, __m128 d, glm::mat4* out, int column) {
+	_MM_TRANSPOSE4_PS(a, b, c, d);
+	_mm_storeu_ps(&out[0][column][0], a);
+	_mm_storeu_ps(&out[1][column][0], b);
+	_mm_storeu_ps(&out[2][column][0], c);
+	_mm_storeu_ps(&out[3][column][0], d);
+}
+
+TARGET_SSE static void composeSse(const TransformArrays& t, int begin, int end, glm::mat4* world, const glm::mat4* vp,
+								  glm::mat4* mvp) {
+	__m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f), two = _mm_set1_ps(2.0f);
+	__m128 p[16];
+	if(mvp)
+		for(int e = 0; e < 16; e++) p[e] = _mm_set1_ps((&(*vp)[0][0])[e]);
+
+	int i = begin;
+	for(; i + 4 <= end; i += 4) {
+		__m128 qx = _mm_loadu_ps(t.rotation_x + i), qy = _mm_loadu_ps(t.rotation_y + i);
+		__m128 qz = _mm_loadu_ps(t.rotation_z + i), qw = _mm_loadu_ps(t.rotation_w + i);
+		__m128 sx = _mm_loadu_ps(t.scale_x + i), sy = _mm_loadu_ps(t.scale_y + i), sz = _mm_loadu_ps(t.scale_z + i);
+		__m128 px = _mm_loadu_ps(t.position_x + i), py = _mm_loadu_ps(t.position_y + i);
+		__m128 pz = _mm_loadu_ps(t.position_z + i);
+
+		__m128 xx = _mm_mul_ps(qx, qx), yy = _mm_mul_ps(qy, qy), zz = _mm_mul_ps(qz, qz);
+		__m128 xy = _mm_mul_ps(qx, qy), xz = _mm_mul_ps(qx, qz), yz = _mm_mul_ps(qy, qz);
+		__m128 wx = _mm_mul_ps(qw, qx), wy = _mm_mul_ps(qw, qy), wz = _mm_mul_ps(qw, qz);
+
+		__m128 m0 = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx);
+		__m128 m1 = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx);
+		__m128 m2 = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx);
+		__m128 m4 = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy);
+		__m128 m5 = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy);
+		__m128 m6 = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy);
+		__m128 m8 = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz);
+		__m128 m9 = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz);
+		__m128 m10 = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz);
+
+		storeColumnsSse(m0, m1, m2, zero, world + i, 0);
+		storeColumnsSse(m4, m5, m6, zero, world + i, 1);
+		storeColumnsSse(m8, m9, m10, zero, world + i, 2);
+		storeColumnsSse(px, py, pz, one, world + i, 3);
+		if(!mvp) continue;
+
+		__m128 columns[4][3] = { { m0, m1, m2 }, { m4, m5, m6 }, { m8, m9, m10 }, { px, py, pz } };
+		for(int column = 0; column < 4; column++) {
+			__m128 r[4];
+			for(int row = 0; row < 4; row++) {
+				r[row] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(p[row], columns[column][0]),
+											   _mm_mul_ps(p[4 + row], columns[column][1])),
+									_mm_mul_ps(p[8 + row], columns[column][2]));
+				if(column == 3) r[row] = _mm_add_ps(r[row], p[12 + row]);
+			}
+			storeColumnsSse(r[0], r[1], r[2], r[3], mvp + i, column);
+		}
+	}
+	composeScalar(t, i, end, world, vp, mvp);
+}
+
+TARGET_AVX2 static inline void storeColumnsAvx2(__m256 a, __m256 b, __m256 c, __m256 d, glm::mat4* out, int column) {
+	__m256 t0 = _mm256_unpacklo_ps(a, b), t1 = _mm256_unpackhi_ps(a, b);
+	__m256 t2 = _mm256_unpacklo_ps(c, d), t3 = _mm256_unpackhi_ps(c, d);
+	__m256 r[4] = { _mm256_shuffle_ps(t0, t2, 0x44), _mm256_shuffle_ps(t0, t2, 0xEE),
+					_mm256_shuffle_ps(t1, t3, 0x44), _mm256_shuffle_ps(t1, t3, 0xEE) };
+	for(int k = 0; k < 4; k++) {
+		_mm_storeu_ps(&out[k][column][0], _mm256_castps256_ps128(r[k]));
+		_mm_storeu_ps(&out[4 + k][column][0], _mm256_extractf128_ps(r[k], 1));
+	}
+}
+
+TARGET_AVX2 static void composeAvx2(const TransformArrays& t, int begin, int end, glm::mat4* world,
+									const glm::mat4* vp, glm::mat4* mvp) {
+	__m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f), two = _mm256_set1_ps(2.0f);
+	__m256 p[16];
+	if(mvp)
+		for(int e = 0; e < 16; e++) p[e] = _mm256_set1_ps((&(*vp)[0][0])[e]);
+
+	int i = begin;
+	for(; i + 8 <= end; i += 8) {
+		__m256 qx = _mm256_loadu_ps(t.rotation_x + i), qy = _mm256_loadu_ps(t.rotation_y + i);
+		__m256 qz = _mm256_loadu_ps(t.rotation_z + i), qw = _mm256_loadu_ps(t.rotation_w + i);
+		__m256 sx = _mm256_loadu_ps(t.scale_x + i), sy = _mm256_loadu_ps(t.scale_y + i);
+		__m256 sz = _mm256_loadu_ps(t.scale_z + i);
+		__m256 px = _mm256_loadu_ps(t.position_x + i), py = _mm256_loadu_ps(t.position_y + i);
+		__m256 pz = _mm256_loadu_ps(t.position_z + i);
+
+		// Products with one factor doubled save the separate multiply by two
+		__m256 x2 = _mm256_mul_ps(two, qx), y2 = _mm256_mul_ps(two, qy), z2 = _mm256_mul_ps(two, qz);
+		__m256 xx = _mm256_mul_ps(qx, x2), yy = _mm256_mul_ps(qy, y2), zz = _mm256_mul_ps(qz, z2);
+		__m256 xy = _mm256_mul_ps(qx, y2), xz = _mm256_mul_ps(qx, z2), yz = _mm256_mul_ps(qy, z2);
+		__m256 wx = _mm256_mul_ps(qw, x2), wy = _mm256_mul_ps(qw, y2), wz = _mm256_mul_ps(qw, z2);
+
+		__m256 m0 = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(yy, zz)), sx);
+		__m256 m1 = _mm256_mul_ps(_mm256_add_ps(xy, wz), sx);
+		__m256 m2 = _mm256_mul_ps(_mm256_sub_ps(xz, wy), sx);
+		__m256 m4 = _mm256_mul_ps(_mm256_sub_ps(xy, wz), sy);
+		__m256 m5 = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, zz)), sy);
+		__m256 m6 = _mm256_mul_ps(_mm256_add_ps(yz, wx), sy);
+		__m256 m8 = _mm256_mul_ps(_mm256_add_ps(xz, wy), sz);
+		__m256 m9 = _mm256_mul_ps(_mm256_sub_ps(yz, wx), sz);
+		__m256 m10 = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, yy)), sz);
+
+		storeColumnsAvx2(m0, m1, m2, zero, world + i, 0);
+		storeColumnsAvx2(m4, m5, m6, zero, world + i, 1);
+		storeColumnsAvx2(m8, m9, m10, zero, world + i, 2);
+		storeColumnsAvx2(px, py, pz, one, world + i, 3);
+		if(!mvp) continue;
+
+		__m256 columns[4][3] = { { m0, m1, m2 }, { m4, m5, m6 }, { m8, m9, m10 }, { px, py, pz } };
+		for(int column = 0; column < 4; column++) {
+			__m256 r[4];
+			for(int row = 0; row < 4; row++) {
+				r[row] = column == 3 ? p[12 + row] : zero;
+				r[row] = _mm256_fmadd_ps(p[row], columns[column][0], r[row]);
+				r[row] = _mm256_fmadd_ps(p[4 + row], columns[column][1], r[row]);
+				r[row] = _mm256_fmadd_ps(p[8 + row], columns[column][2], r[row]);
+			}
+			storeColumnsAvx2(r[0], r[1], r[2], r[3], mvp + i, column);
+		}
+	}
+	composeScalar(t, i, end, world, vp, mvp);
+}
+
+TARGET_AVX512 static inline void storeColumnsAvx512(__m512 a, __m512 b, __m512 c, __m512 d, glm::mat4* out,
+													 int column) {
+	__m512 t0 = _mm512_unpacklo_ps(a, b), t1 = _mm512_unpackhi_ps(a, b);
+	__m512 t2 = _mm512_unpacklo_ps(c, d), t3 = _mm512_unpackhi_ps(c, d);
+	__m512 r[4] = { _mm512_shuffle_ps(t0, t2, 0x44), _mm512_shuffle_ps(t0, t2, 0xEE),
+					_mm512_shuffle_ps(t1, t3, 0x44), _mm512_shuffle_ps(t1, t3, 0xEE) };
+	for(int k = 0; k < 4; k++) {
+		_mm_storeu_ps(&out[k][column][0], _mm512_extractf32x4_ps(r[k], 0));
+		_mm_storeu_ps(&out[4 + k][column][0], _mm512_extractf32x4_ps(r[k], 1));
+		_mm_storeu_ps(&out[8 + k][column][0], _mm512_extractf32x4_ps(r[k], 2));
+		_mm_storeu_ps(&out[12 + k][column][0], _mm512_extractf32x4_ps(r[k], 3));
+	}
+}
+
+TARGET_AVX512 static void composeAvx512(const TransformArrays& t, int begin, int end, glm::mat4* world,
+										const glm::mat4* vp, glm::mat4* mvp) {
+	__m512 zero = _mm512_setzero_ps(), one = _mm512_set1_ps(1.0f), two = _mm512_set1_ps(2.0f);
+	__m512 p[16];
+	if(mvp)
+		for(int e = 0; e < 16; e++) p[e] = _mm512_set1_ps((&(*vp)[0][0])[e]);
+
+	int i = begin;
+	for(; i + 16 <= end; i += 16) {
+		__m512 qx = _mm512_loadu_ps(t.rotation_x + i), qy = _mm512_loadu_ps(t.rotation_y + i);
+		__m512 qz = _mm512_loadu_ps(t.rotation_z + i), qw = _mm512_loadu_ps(t.rotation_w + i);
+		__m512 sx = _mm512_loadu_ps(t.scale_x + i), sy = _mm512_loadu_ps(t.scale_y + i);
+		__m512 sz = _mm512_loadu_ps(t.scale_z + i);
+		__m512 px = _mm512_loadu_ps(t.position_x + i), py = _mm512_loadu_ps(t.position_y + i);
+		__m512 pz = _mm512_loadu_ps(t.position_z + i);
+
+		__m512 x2 = _mm512_mul_ps(two, qx), y2 = _mm512_mul_ps(two, qy), z2 = _mm512_mul_ps(two, qz);
+		__m512 xx = _mm512_mul_ps(qx, x2), yy = _mm512_mul_ps(qy, y2), zz = _mm512_mul_ps(qz, z2);
+		__m512 xy = _mm512_mul_ps(qx, y2), xz = _mm512_mul_ps(qx, z2), yz = _mm512_mul_ps(qy, z2);
+		__m512 wx = _mm512_mul_ps(qw, x2), wy = _mm512_mul_ps(qw, y2), wz = _mm512_mul_ps(qw, z2);
+
+		__m512 m0 = _mm512_mul_ps(_mm512_sub_ps(one, _mm512_add_ps(yy, zz)), sx);
+		__m512 m1 = _mm512_mul_ps(_mm512_add_ps(xy, wz), sx);
+		__m512 m2 = _mm512_mul_ps(_mm512_sub_ps(xz, wy), sx);
+		__m512 m4 = _mm512_mul_ps(_mm512_sub_ps(xy, wz), sy);
+		__m512 m5 = _mm512_mul_ps(_mm512_sub_ps(one, _mm512_add_ps(xx, zz)), sy);
+		__m512 m6 = _mm512_mul_ps(_mm512_add_ps(yz, wx), sy);
+		__m512 m8 = _mm512_mul_ps(_mm512_add_ps(xz, wy), sz);
+		__m512 m9 = _mm512_mul_ps(_mm512_sub_ps(yz, wx), sz);
+		__m512 m10 = _mm512_mul_ps(_mm512_sub_ps(one, _mm512_add_ps(xx, yy)), sz);
+
+		storeColumnsAvx512(m0, m1, m2, zero, world + i, 0);
+		storeColumnsAvx512(m4, m5, m6, zero, world + i, 1);
+		storeColumnsAvx512(m8, m9, m10, zero, world + i, 2);
+		storeColumnsAvx512(px, py, pz, one, world + i, 3);
+		if(!mvp) continue;
+
+		__m512 columns[4][3] = { { m0, m1, m2 }, { m4, m5, m6 }, { m8, m9, m10 }, { px, py, pz } };
+		for(int column = 0; column < 4; column++) {
+			__m512 r[4];
+			for(int row = 0; row < 4; row++) {
+				r[row] = column == 3 ? p[12 + row] : zero;
+				r[row] = _mm512_fmadd_ps(p[row], columns[column][0], r[row]);
+				r[row] = _mm512_fmadd_ps(p[4 + row], columns[column][1], r[row]);
+				r[row] = _mm512_fmadd_ps(p[8 + row], columns[column][2], r[row]);
+			}
+			storeColumnsAvx512(r[0], r[1], r[2], r[3], mvp + i, column);
+		}
+	}
+	composeScalar(t, i, end, world, vp, mvp);
+}
+
+#endif
+
+bool isTransformKernelSupported(TransformKernel kernel) {
+	switch(kernel) {
+	case TRANSFORM_KERNEL_SCALAR:
+		return true;
+#ifdef TRANSFORM_KERNELS_X86
+	case TRANSFORM_KERNEL_SSE:
+		return __builtin_cpu_supports("sse2");
+	case TRANSFORM_KERNEL_AVX2:
+		return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+	case TRANSFORM_KERNEL_AVX512:
+		return __builtin_cpu_supports("avx512f");
+#endif
+	default:
+		return false;
+	}
+}
+
+const char* getTransformKernelName(TransformKernel kernel) {
+	static const char* names[TRANSFORM_KERNEL_COUNT] = { "scalar", "sse", "avx2", "avx512" };
+	return kernel < TRANSFORM_KERNEL_COUNT ? names[kernel] : "best";
+}
+
+TransformKernel getBestTransformKernel() {
+	static TransformKernel best = []() {
+		int kernel = TRANSFORM_KERNEL_COUNT - 1;
+		while(kernel > TRANSFORM_KERNEL_SCALAR && !isTransformKernelSupported((TransformKernel)kernel)) kernel--;
+		return (TransformKernel)kernel;
+	}();
+	return best;
+}
+
+void composeTransforms(const TransformArrays& transforms, int begin, int end, glm::mat4* world,
+					   const glm::mat4* view_projection, glm::mat4* mvp, TransformKernel kernel) {
+	if(!view_projection) mvp = nullptr;
+	if(kernel == TRANSFORM_KERNEL_BEST) kernel = getBestTransformKernel();
+	switch(kernel) {
+#ifdef TRANSFORM_KERNELS_X86
+	case TRANSFORM_KERNEL_SSE:
+		composeSse(transforms, begin, end, world, view_projection, mvp);
+		break;
+	case TRANSFORM_KERNEL_AVX2:
+		composeAvx2(transforms, begin, end, world, view_projection, mvp);
+		break;
+	case TRANSFORM_KERNEL_AVX512:
+		composeAvx512(transforms, begin, end, world, view_projection, mvp);
+		break;
+#endif
+	default:
+		composeScalar(transforms, begin, end, world, view_projection, mvp);
+		break;
+	}
+}
@@ -0,0 +1,137 @@
+#include <algorithm>
+#include <cmath>
+#include "WorldPartition.h"
+
+WorldPartition::WorldPartition(AssetStreamer& streamer, ChunkSource source, float chunk_size, float load_radius,
+							   float prefetch_distance, size_t memory_cap)
+	: streamer_(streamer), source_(source), chunk_size_(chunk_size), load_radius_(load_radius),
+	  prefetch_distance_(prefetch_distance), memory_cap_(memory_cap), next_id_(1), resident_bytes_(0),
+	  loads_in_flight_(0) {}
+
+float WorldPartition::getPriority(int x, int z, const glm::vec3& position, const glm::vec3& front) {
+	// Distance to the chunk center, shortened for chunks ahead of the camera
+	float dx = (x + 0.5f) * chunk_size_ - position.x;
+	float dz = (z + 0.5f) * chunk_size_ - position.z;
+	float distance = sqrtf(dx * dx + dz * dz);
+	float ahead = distance > 0.0f ? (dx * front.x + dz * front.z) / distance : 0.0f;
+	return distance - prefetch_distance_ * (ahead > 0.0f ? ahead : 0.0f);
+}
+
+void WorldPartition::update(const glm::vec3& position, const glm::vec3& front, std::vector<uint32_t>& evicted) {
+	evicted.clear();
+	{
+		std::lock_guard<std::mutex> lock(loaded_mutex_);
+		for(size_t i = 0; i < loaded_.size(); i++) {
+			loads_in_flight_--;
+			std::map<uint32_t, std::pair<int, int>>::iterator id = ids_.find(loaded_[i].first);
+			if(id == ids_.end()) continue;
+			Chunk& chunk = chunks_[id->second];
+			chunk.loaded = true;
+			chunk.bytes = loaded_[i].second;
+			resident_bytes_ += chunk.bytes;
+		}
+		loaded_.clear();
+	}
+
+	// Only the heading on the ground plane matters
+	glm::vec3 heading(front.x, 0.0f, front.z);
+	float length = sqrtf(heading.x * heading.x + heading.z * heading.z);
+	heading = length > 0.0001f ? heading / length : glm::vec3(0.0f);
+
+	int loaded_count = 0;
+	std::map<std::pair<int, int>, Chunk>::iterator it = chunks_.begin();
+	while(it != chunks_.end()) {
+		Chunk& chunk = it->second;
+		chunk.priority = getPriority(it->first.first, it->first.second, position, heading);
+		if(chunk.priority <= load_radius_ + chunk_size_) {
+			loaded_count += chunk.loaded;
+			++it;
+			continue;
+		}
+		if(chunk.loaded) resident_bytes_ -= chunk.bytes;
+		evicted.push_back(chunk.id);
+		ids_.erase(chunk.id);
+		it = chunks_.erase(it);
+	}
+
+	// Everything within reach that is wanted but not tracked yet, nearest first
+	std::vector<std::pair<float, std::pair<int, int>>> candidates;
+	float reach = load_radius_ + prefetch_distance_;
+	int min_x = (int)floorf((position.x - reach) / chunk_size_), max_x = (int)floorf((position.x + reach) / chunk_size_);
+	int min_z = (int)floorf((position.z - reach) / chunk_size_), max_z = (int)floorf((position.z + reach) / chunk_size_);
+	for(int z = min_z; z <= max_z; z++) {
+		for(int x = min_x; x <= max_x; x++) {
+			float priority = getPriority(x, z, position, heading);
+			if(priority <= load_radius_ && chunks_.find(std::make_pair(x, z)) == chunks_.end())
+				candidates.push_back(std::make_pair(priority, std::make_pair(x, z)));
+		}
+	}
+	std::sort(candidates.begin(), candidates.end());
+
+	for(size_t c = 0; c < candidates.size() && loads_in_flight_ < MAX_LOADS_IN_FLIGHT; c++) {
+		// Chunks still loading are assumed to be as large as the average so far
+		size_t estimate = loaded_count > 0 ? resident_bytes_ / loaded_count : 0;
+		size_t committed = resident_bytes_ + (chunks_.size() - loaded_count) * estimate;
+		bool room = true;
+		while(committed + estimate > memory_cap_) {
+			std::map<std::pair<int, int>, Chunk>::iterator worst = chunks_.end();
+			for(it = chunks_.begin(); it != chunks_.end(); ++it)
+				if(it->second.loaded && (worst == chunks_.end() || it->second.priority > worst->second.priority)) worst = it;
+			if(worst == chunks_.end() || worst->second.priority <= candidates[c].first) {
+				room = false;
+				break;
+			}
+
+			resident_bytes_ -= worst->second.bytes;
+			committed -= worst->second.bytes;
+			loaded_count--;
+			evicted.push_back(worst->second.id);
+			ids_.erase(worst->second.id);
+			chunks_.erase(worst);
+		}
+		if(!room) break;
+
+		int x = candidates[c].second.first;
+		int z = candidates[c].second.second;
+		uint32_t id = next_id_++;
+		Chunk chunk = { id, 0, false, candidates[c].first };
+		chunks_[std::make_pair(x, z)] = chunk;
+		ids_[id] = std::make_pair(x, z);
+		loads_in_flight_++;
+
+		streamer_.request([this, x, z, id]() {
+			std::vector<StreamedMesh> meshes;
+			source_(x, z, meshes);
+			size_t bytes = 0;
+			for(size_t i = 0; i < meshes.size(); i++) {
+				meshes[i].group = id;
+				bytes += (meshes[i].prism.getVertexCount() + meshes[i].prism.getIndexCount()) * sizeof(uint32_t);
+				if(meshes[i].collision) bytes += meshes[i].collision->getByteSize();
+				streamer_.submit(meshes[i]);
+			}
+			std::lock_guard<std::mutex> lock(loaded_mutex_);
+			loaded_.push_back(std::make_pair(id, bytes));
+		});
+	}
+}
+
+bool WorldPartition::accept(uint32_t chunk) {
+	// Meshes outside any chunk are always kept
+	return chunk == 0 || ids_.find(chunk) != ids_.end();
+}
+
+bool WorldPartition::getOrigin(uint32_t chunk, glm::vec3& origin) {
+	// Only known while the chunk is tracked
+	std::map<uint32_t, std::pair<int, int>>::iterator id = ids_.find(chunk);
+	if(id == ids_.end()) return false;
+	origin = glm::vec3(id->second.first * chunk_size_, 0.0f, id->second.second * chunk_size_);
+	return true;
+}
+
+int WorldPartition::getResidentCount() {
+	return chunks_.size();
+}
+
+size_t WorldPartition::getResidentBytes() {
+	return resident_bytes_;
+}
@@ -1,40 +1,257 @@
 #include <SDL3/SDL.h>
 #include <glad/glad.h>
+#include <algorithm>
 #include <iostream>
 #include <cmath>
 #include <vector>
 #include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <string>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include "Prism.h"
+#include "AssetStreamer.h"
+#include "Camera.h"
+#include "GLDebug.h"
+#include "GLStateCache.h"
+#include "Benchmark.h"
+#include "CollisionWorld.h"
+#include "CommandList.h"
+#include "CommandReplayer.h"
+#include "EntityStore.h"
+#include "FramePipeline.h"
+#include "GltfFile.h"
+#include "GpuTimer.h"
+#include "Hud.h"
+#include "JobSystem.h"
+#include "MeshImporter.h"
+#include "MeshPool.h"
+#include "ProgramCache.h"
+#include "RingBuffer.h"
+#include "SceneFile.h"
+#include "SceneGraph.h"
+#include "ShaderManager.h"
+#include "SortKey.h"
+#include "WorldPartition.h"
 
 #define PI 3.141592f
 #define CAMERA_SPEED 0.1f
 #define MOUSE_SENSITIVITY 0.1f
+#define CAMERA_RADIUS 0.2f
+#define COLLISION_CELL_SIZE 2.0f
+#define COLLISION_INSTANCE_CELL_SIZE 16.0f
 #define WIREFRAME_ENABLED true
-
+#define FRAME_DATA_SIZE (4 * 1024 * 1024)
+#define DRAW_DATA_SIZE (16 * 1024 * 1024)
+#define MESH_PAGE_VERTICES (256 * 1024)
+#define MESH_PAGE_INDICES (1024 * 1024)
+#define DEFRAG_BUDGET (256 * 1024)
+#define UPLOAD_BUDGET (2 * 1024 * 1024)
+#define WORLD_CHUNK_SIZE 32.0f
+#define WORLD_CHUNK_CELLS 64
+#define WORLD_LOAD_RADIUS 96.0f
+#define WORLD_PREFETCH_DISTANCE 48.0f
+#define WORLD_MEMORY_CAP (16 * 1024 * 1024)
+#define PIPELINE_LATENCY 1
+#define WIREFRAME_BENCHMARK_GRID 700
+#define WIREFRAME_BENCHMARK_DRAWS 20
+#define COMMAND_CHUNK_SIZE 256
+#define ENTITY_UPDATE_GRAIN 4096
+
+// Scene shaders, specialized per feature set by the shader manager
 const char* vertexShaderSource = R"glsl(
 	#version 330 core
 
+	// With WIREFRAME the geometry shader sits between this stage and the
+	// fragment shader and forwards these as the fragment inputs
+#ifdef WIREFRAME
+	#define COLOR_OUTPUT vColor
+	#define WORLD_POSITION_OUTPUT vWorldPosition
+#else
+	#define COLOR_OUTPUT fColor
+	#define WORLD_POSITION_OUTPUT fWorldPosition
+#endif
+
+#ifdef DRAW_TABLES
+	// Everything that differs between draws is looked up by gl_BaseInstance,
+	// which each indirect command sets to the draw's slot in these tables, so
+	// draws with different transforms and materials merge into one
+	// multi-draw. Layouts match DrawRecord in this file.
+	struct DrawRecord {
+		uint material;
+		uint firstIndex;
+		uint firstWord;
+		uint format;
+		vec4 positionScale;
+		vec4 positionOffset;
+	};
+	layout(std430, binding = 2) readonly buffer DrawRecords { DrawRecord draws[]; };
+	layout(std430, binding = 3) readonly buffer Transforms { mat4 transforms[]; };
+	layout(std430, binding = 4) readonly buffer Materials { vec4 materials[]; };
+#endif
+
+#ifdef VERTEX_PULLING
+	// Requires DRAW_TABLES. Vertices and indices are read straight from the
+	// mesh pool page, so meshes of every vertex format draw without a vertex
+	// array layout. Formats match VertexFormat in MeshPool.h.
+	layout(std430, binding = 0) readonly buffer VertexWords { uint vertexWords[]; };
+	layout(std430, binding = 1) readonly buffer Indices { uint indices[]; };
+
+	vec3 fetchPosition(DrawRecord draw)
+	{
+		uint vertex = indices[draw.firstIndex + uint(gl_VertexID)];
+		if(draw.format == 0u) {
+			uint word = draw.firstWord + vertex * 3u;
+			return uintBitsToFloat(uvec3(vertexWords[word], vertexWords[word + 1u], vertexWords[word + 2u]));
+		}
+
+		uint word = draw.firstWord + vertex * 2u;
+		vec3 position = vec3(unpackUnorm2x16(vertexWords[word]), unpackUnorm2x16(vertexWords[word + 1u]).x);
+		return position * draw.positionScale.xyz + draw.positionOffset.xyz;
+	}
+#else
 	layout(location = 0) in vec3 aPosition;
+#endif
 
+#if defined(QUANTIZED_POSITIONS) && !defined(DRAW_TABLES)
+	// Normalized 16 bit positions, expanded by the mesh bounds
+	uniform vec3 uPositionScale;
+	uniform vec3 uPositionOffset;
+#endif
+
+#ifdef DRAW_TABLES
+	out vec4 COLOR_OUTPUT;
+#endif
+
+#ifndef DRAW_TABLES
 	uniform mat4 uModel;
+#endif
+
 	uniform mat4 uView;
 	uniform mat4 uProjection;
 
+#ifdef LIGHTING
+	out vec3 WORLD_POSITION_OUTPUT;
+#endif
+
+	void main()
+	{
+#ifdef DRAW_TABLES
+		DrawRecord draw = draws[gl_BaseInstance];
+#endif
+
+#if defined(VERTEX_PULLING)
+		vec3 position = fetchPosition(draw);
+#elif defined(DRAW_TABLES)
+		// Float meshes have unit scale and no offset
+		vec3 position = aPosition * draw.positionScale.xyz + draw.positionOffset.xyz;
+#elif defined(QUANTIZED_POSITIONS)
+		vec3 position = aPosition * uPositionScale + uPositionOffset;
+#else
+		vec3 position = aPosition;
+#endif
+
+#ifdef DRAW_TABLES
+		vec4 worldPosition = transforms[gl_BaseInstance] * vec4(position, 1.0);
+#else
+		vec4 worldPosition = uModel * vec4(position, 1.0);
+#endif
+
+#ifdef DRAW_TABLES
+		COLOR_OUTPUT = materials[draw.material];
+#endif
+#ifdef LIGHTING
+		WORLD_POSITION_OUTPUT = worldPosition.xyz;
+#endif
+		gl_Position = uProjection * uView * worldPosition;
+	}
+)glsl";
+
+// Only used by WIREFRAME variants: gives each triangle corner a barycentric
+// coordinate so the fragment shader can draw edges over the filled triangle
+const char* geometryShaderSource = R"glsl(
+	#version 330 core
+
+	layout(triangles) in;
+	layout(triangle_strip, max_vertices = 3) out;
+
+#ifdef DRAW_TABLES
+	in vec4 vColor[];
+	out vec4 fColor;
+#endif
+#ifdef LIGHTING
+	in vec3 vWorldPosition[];
+	out vec3 fWorldPosition;
+#endif
+
+	noperspective out vec3 fBarycentric;
+
 	void main()
 	{
-		gl_Position = uProjection * uView * uModel * vec4(aPosition, 1.0);
+		for(int i = 0; i < 3; i++) {
+			gl_Position = gl_in[i].gl_Position;
+#ifdef DRAW_TABLES
+			fColor = vColor[i];
+#endif
+#ifdef LIGHTING
+			fWorldPosition = vWorldPosition[i];
+#endif
+			fBarycentric = vec3(0.0);
+			fBarycentric[i] = 1.0;
+			EmitVertex();
+		}
+		EndPrimitive();
 	}
 )glsl";
 
 const char* fragmentShaderSource = R"glsl(
     #version 330 core
     out vec4 FragColor;
+
+#ifdef DRAW_TABLES
+	in vec4 fColor;
+#endif
+#ifdef LIGHTING
+	in vec3 fWorldPosition;
+#endif
+#ifdef WIREFRAME
+	noperspective in vec3 fBarycentric;
+#endif
+
     void main()
     {
-        FragColor = vec4(1.0, 0.5, 0.2, 1.0); // orange color
+#ifdef DRAW_TABLES
+		vec4 color = fColor;
+#else
+		vec4 color = vec4(1.0, 0.5, 0.2, 1.0); // orange color
+#endif
+
+#ifdef LIGHTING
+		// Flat shading from screen space derivatives, no normals needed
+		vec3 normal = normalize(cross(dFdx(fWorldPosition), dFdy(fWorldPosition)));
+		float diffuse = max(dot(normal, normalize(vec3(0.4, 1.0, 0.3))), 0.0);
+		vec3 shaded = color.rgb * (0.25 + 0.75 * diffuse);
+#else
+		vec3 shaded = color.rgb;
+#endif
+
+#ifdef WIREFRAME
+		// Antialiased edges about one and a half pixels wide over a dimmed fill
+		vec3 width = fwidth(fBarycentric) * 1.5;
+		vec3 edges = smoothstep(vec3(0.0), width, fBarycentric);
+		float edge = 1.0 - min(min(edges.x, edges.y), edges.z);
+		shaded = mix(shaded * 0.3, color.rgb, edge);
+#endif
+
+        FragColor = vec4(shaded, color.a);
     }
 )glsl";
 
@@ -70,16 +287,41 @@ unsigned int cubeIndices[] = {
     6, 7, 3
 };
 
-uint8_t keys_held = 0;
-glm::vec3 camera_position = glm::vec3(0.0f, 0.0f, -3.0f);
-float camera_yaw = 90.0f;
-float camera_pitch = 0;
-std::vector<Prism> prism_array;
+// Input is gathered on the render thread and consumed by the simulation thread
+std::atomic<uint8_t> keys_held(0);
+std::mutex input_mutex;
+float mouse_xrel = 0;
+float mouse_yrel = 0;
+
+// Owned by the simulation thread
+Camera camera(glm::vec3(0.0f, 0.0f, -3.0f), 90.0f, 0.0f, 45.0f, 800.0f / 600.0f, 0.1f, 100.0f);
+std::vector<uint8_t> entity_visible;
+// Guards the entities and material table, mutated on the render and
+// loader threads and read by the simulation
+std::mutex scene_mutex;
+SceneGraph scene_graph;
+EntityStore entities;
+// Root node of each world chunk, its entities are placed below it
+std::unordered_map<uint32_t, SceneNode> chunk_nodes;
+CollisionWorld collision_world(COLLISION_INSTANCE_CELL_SIZE);
+// Material table, colors indexed by the prisms' material
+std::vector<glm::vec4> material_colors = { glm::vec4(1.0f, 0.5f, 0.2f, 1.0f) };
+// Removed meshes' handles outlive every snapshot that may still draw them
+MeshPool mesh_pool(MESH_PAGE_VERTICES, MESH_PAGE_INDICES, PIPELINE_LATENCY + 1);
+Hud hud;
+bool wireframe_enabled = WIREFRAME_ENABLED;
+bool vertex_pulling_enabled = false;
+bool draw_tables_enabled = false;
+ProgramCache program_cache;
+ShaderManager shader_manager(program_cache);
 
 void init(SDL_Window** window, SDL_GLContext* glContext) {
     // Initialize SDL3 with OpenGL
     SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS);
 
+    // Filled triangles need a depth buffer to hide what is behind them
+    SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
+
     // Create an SDL window with OpenGL context
     *window = SDL_CreateWindow("d3",
 	   						    800, 
@@ -87,89 +329,210 @@ void init(SDL_Window** window, SDL_GLContext* glContext) {
 							    SDL_WINDOW_OPENGL | SDL_WINDOW_FULLSCREEN);
 
     // Create OpenGL context
+	requestDebugContext();
     *glContext = SDL_GL_CreateContext(*window);
 
     // Initialize GLAD to load OpenGL functions
     gladLoadGLLoader((GLADloadproc)SDL_GL_GetProcAddress);
 
+	// Report OpenGL errors through the debug callback
+	initializeDebugOutput();
+	glDepthFunc(GL_LESS);
+
 	// Capture mouse
 	SDL_SetWindowRelativeMouseMode(*window, true);
 }
 
-GLuint initializeShaders() {
-    // Vertex Shader
-    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, nullptr);
-    glCompileShader(vertexShader);
+void initializeShaderManager() {
+	char* prefPath = SDL_GetPrefPath("d3", "d3");
+	std::string directory = prefPath ? std::string(prefPath) + "shader_cache" : "shader_cache";
+	SDL_free(prefPath);
+	program_cache.initialize(directory);
+	shader_manager.initialize((GLADloadproc)SDL_GL_GetProcAddress);
+}
 
-    // Fragment Shader
-    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, nullptr);
-    glCompileShader(fragmentShader);
+ShaderHandle initializeShaders(uint32_t features) {
+	// Loaded from the binary cache or compiled in the background
+	const char* geometrySource = (features & SHADER_WIREFRAME) ? geometryShaderSource : nullptr;
+	return shader_manager.requestVariant("scene", vertexShaderSource, fragmentShaderSource, features, geometrySource);
+}
 
-    // Shader Program
-    GLuint shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
+struct SceneProgram {
+	GLuint program;
+	GLint model;
+	GLint view;
+	GLint projection;
+	GLint position_scale;
+	GLint position_offset;
+};
 
-    // Cleanup shaders
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+// Per-draw record read by DRAW_TABLES variants, std430 layout
+struct DrawRecord {
+	uint32_t material;
+	uint32_t first_index;
+	uint32_t first_word;
+	uint32_t format;
+	float position_scale[4];
+	float position_offset[4];
+};
 
-	return shaderProgram;
-}
+// Indirect command layouts defined by GL
+struct DrawElementsIndirectCommand {
+	GLuint count;
+	GLuint instance_count;
+	GLuint first_index;
+	GLint base_vertex;
+	GLuint base_instance;
+};
 
-void initializeVertexBuffer(GLuint* VAO, GLuint* VBO, GLuint* EBO) {
+struct DrawArraysIndirectCommand {
+	GLuint count;
+	GLuint instance_count;
+	GLuint first;
+	GLuint base_instance;
+};
 
-    // Setup Vertex Array and Buffer Objects (VAO, VBO)
-    glGenVertexArrays(1, VAO);
-    glGenBuffers(1, VBO);
-    glGenBuffers(1, EBO);
+// Per-frame tables in the ring buffer, one slot per sorted draw
+struct DrawTables {
+	DrawRecord* records;
+	glm::mat4* transforms;
+	uint8_t* commands;
+	GLintptr commands_offset;
+	bool pulling;
+};
 
-    // Bind VAO
-    glBindVertexArray(*VAO);
+// Consecutive sorted draws that can go into one multi-draw
+struct DrawRun {
+	int page;
+	VertexFormat format;
+	int begin;
+	int end;
+	int triangles;
+};
 
-	// Calculate data size
-	GLsizeiptr totalSize = 0;
-	for(Prism p : prism_array)
-		totalSize += p.getVertexCount() * sizeof(float);
+uint32_t getSceneFeatures(bool wireframe, bool vertexPulling) {
+	// Vertex pulling finds its draw in the tables, so it needs them too
+	uint32_t features = wireframe ? SHADER_LIGHTING | SHADER_WIREFRAME : SHADER_LIGHTING;
+	if(draw_tables_enabled) features |= SHADER_DRAW_TABLES;
+	if(draw_tables_enabled && vertexPulling) features |= SHADER_VERTEX_PULLING;
+	return features;
+}
 
-	// Allocate data size
-    glBindBuffer(GL_ARRAY_BUFFER, *VBO);
-	glBufferData(GL_ARRAY_BUFFER, totalSize, nullptr, GL_STATIC_DRAW);
+SceneProgram getSceneProgram(uint32_t features) {
+	// Only waits if this variant is still compiling
+	SceneProgram scene;
+	scene.program = shader_manager.get(initializeShaders(features));
+	scene.model = glGetUniformLocation(scene.program, "uModel");
+	scene.view = glGetUniformLocation(scene.program, "uView");
+	scene.projection = glGetUniformLocation(scene.program, "uProjection");
+	scene.position_scale = glGetUniformLocation(scene.program, "uPositionScale");
+	scene.position_offset = glGetUniformLocation(scene.program, "uPositionOffset");
+	return scene;
+}
+
+void getScenePrograms(bool wireframe, bool vertexPulling, SceneProgram programs[2]) {
+	// Indexed by vertex format. Draw tables carry each draw's format, so one
+	// program draws both; per-prism draws need the quantized variant.
+	uint32_t features = getSceneFeatures(wireframe, vertexPulling);
+	programs[VERTEX_FORMAT_FLOAT3] = getSceneProgram(features);
+	programs[VERTEX_FORMAT_UNORM16X3] = draw_tables_enabled ? programs[VERTEX_FORMAT_FLOAT3]
+															: getSceneProgram(features | SHADER_QUANTIZED_POSITIONS);
+}
 
-    // Upload vertex data
-	GLsizeiptr data_offset = 0;
-	for(Prism p : prism_array) {
-		GLsizeiptr current_size = p.getVertexCount() * sizeof(float);
-		glBufferSubData(GL_ARRAY_BUFFER, data_offset, current_size, p.getVertices());
-		data_offset += current_size;
+void addStreamedMesh(MeshHandle mesh, StreamedMesh& streamed) {
+	// One entity per placement, the first takes over the streamer's reference
+	std::lock_guard<std::mutex> lock(scene_mutex);
+	for(size_t i = 0; i < streamed.placements.size(); i++) {
+		if(i > 0) mesh_pool.retain(mesh);
+		const StreamedPlacement& placement = streamed.placements[i];
+		EntityHandle entity = entities.create(mesh, streamed.prism, placement.material, streamed.group);
+		if(entity == INVALID_ENTITY) {
+			mesh_pool.remove(mesh);
+			continue;
+		}
+		entities.setTransform(entity, placement.transform);
+		entities.setParent(entity, placement.node);
+		entities.setBounds(entity, streamed.bounds_min, streamed.bounds_max);
+		glm::mat4 world = scene_graph.resolveWorldTransform(placement.node) * placement.transform;
+		collision_world.add(entity, streamed.collision, world);
 	}
+}
 
-	// Allocate element buffer
-	totalSize = 0;	
-	for(Prism p : prism_array)
-		totalSize += p.getIndexCount() * sizeof(unsigned int);
+void submitPrism(AssetStreamer& streamer, Prism prism, VertexFormat format = VERTEX_FORMAT_FLOAT3) {
+	StreamedPlacement placement = { 0, glm::mat4(1.0f), INVALID_SCENE_NODE };
+	StreamedMesh mesh = { prism, { placement }, 0, format };
+	mesh.collision = std::make_shared<CollisionShape>(mesh.prism, COLLISION_CELL_SIZE);
+	streamer.submit(mesh);
+}
 
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, *EBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, totalSize, nullptr, GL_STATIC_DRAW);
+void removeChunk(uint32_t chunk) {
+	// Backwards, so entities swapped into a hole have already been checked
+	std::lock_guard<std::mutex> lock(scene_mutex);
+	for(int i = entities.getCount(); i-- > 0;) {
+		if(entities.getGroups()[i] != chunk) continue;
+		mesh_pool.remove(entities.getMeshes()[i]);
+		collision_world.remove(entities.getHandle(i));
+		entities.destroy(entities.getHandle(i));
+	}
+
+	std::unordered_map<uint32_t, SceneNode>::iterator node = chunk_nodes.find(chunk);
+	if(node == chunk_nodes.end()) return;
+	scene_graph.destroy(node->second);
+	chunk_nodes.erase(node);
+}
 
-	// Upload element data
-	data_offset = 0;
-	for(Prism p : prism_array) {
-		GLsizeiptr current_size = p.getIndexCount() * sizeof(unsigned int);
-		glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, data_offset, current_size, p.getIndices());
-		data_offset += current_size;
+void placeInChunk(StreamedMesh& streamed, WorldPartition& worldPartition) {
+	// The first mesh of a chunk creates its root node at the chunk's corner
+	glm::vec3 origin;
+	if(!worldPartition.getOrigin(streamed.group, origin)) return;
+	SceneNode root;
+	{
+		std::lock_guard<std::mutex> lock(scene_mutex);
+		std::unordered_map<uint32_t, SceneNode>::iterator node = chunk_nodes.find(streamed.group);
+		if(node != chunk_nodes.end()) {
+			root = node->second;
+		} else {
+			root = scene_graph.create();
+			scene_graph.setLocalTransform(root, glm::translate(glm::mat4(1.0f), origin));
+			chunk_nodes[streamed.group] = root;
+		}
 	}
+	for(size_t i = 0; i < streamed.placements.size(); i++)
+		streamed.placements[i].node = root;
+}
 
-    // Define vertex attributes (position attribute)
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
+float getTerrainHeight(float x, float z) {
+	return -3.0f + 2.0f * sin(x * 0.05f) * cos(z * 0.07f) + 0.5f * sin(x * 0.23f + z * 0.17f);
+}
 
-    // Unbind VBO and VAO
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+void generateTerrainChunk(int x, int z, std::vector<StreamedMesh>& meshes) {
+	// Heightfield tile in chunk space, heights come from world space so
+	// neighbouring tiles meet without seams
+	int cells = WORLD_CHUNK_CELLS;
+	float step = WORLD_CHUNK_SIZE / cells;
+	std::vector<float> vertices;
+	std::vector<unsigned int> indices;
+	vertices.reserve((cells + 1) * (cells + 1) * 3);
+	indices.reserve(cells * cells * 6);
+	for(int j = 0; j <= cells; j++) {
+		for(int i = 0; i <= cells; i++) {
+			vertices.push_back(i * step);
+			vertices.push_back(getTerrainHeight(x * WORLD_CHUNK_SIZE + i * step, z * WORLD_CHUNK_SIZE + j * step));
+			vertices.push_back(j * step);
+		}
+	}
+	for(int j = 0; j < cells; j++) {
+		for(int i = 0; i < cells; i++) {
+			unsigned int corner = j * (cells + 1) + i;
+			unsigned int quad[6] = { corner, corner + cells + 1, corner + 1, corner + 1, corner + cells + 1, corner + cells + 2 };
+			indices.insert(indices.end(), quad, quad + 6);
+		}
+	}
+
+	StreamedPlacement placement = { 0, glm::mat4(1.0f), INVALID_SCENE_NODE };
+	StreamedMesh mesh = { Prism(std::move(vertices), std::move(indices)), { placement }, 0 };
+	mesh.collision = std::make_shared<CollisionShape>(mesh.prism, COLLISION_CELL_SIZE);
+	meshes.push_back(mesh);
 }
 
 bool handleKeyboardInput(SDL_Event event) {
@@ -187,6 +550,16 @@ bool handleKeyboardInput(SDL_Event event) {
 			case SDLK_D:
 				keys_held |= (1 << 3);
 				break;
+			case SDLK_F1:
+				hud.toggle();
+				break;
+			case SDLK_F2:
+				wireframe_enabled = !wireframe_enabled;
+				break;
+			case SDLK_F3:
+				// Pulling needs the draw tables
+				vertex_pulling_enabled = !vertex_pulling_enabled && draw_tables_enabled;
+				break;
 			case SDLK_ESCAPE:
 				return false; 
 		}
@@ -212,60 +585,524 @@ bool handleKeyboardInput(SDL_Event event) {
 
 }
 
-glm::vec3 getCameraFront() {
-	glm::vec3 front;
-	front.x = cos(glm::radians(camera_yaw)) * cos(glm::radians(camera_pitch));
-	front.y = sin(glm::radians(camera_pitch));
-	front.z = sin(glm::radians(camera_yaw)) * cos(glm::radians(camera_pitch));
-	front = glm::normalize(front);
-	return front;
-}
-
 void updateCameraPosition() {
-	glm::vec3 camera_front = getCameraFront();
-	camera_front.y = 0;
-	camera_front = glm::normalize(camera_front); // Project front vector to xz plane
-	glm::vec3 camera_right = glm::cross(camera_front, glm::vec3(0.0f, 1.0f, 0.0f));
-	if((keys_held & (1 << 0))) camera_position += CAMERA_SPEED * camera_front; // Forward
-	if((keys_held & (1 << 1))) camera_position -= CAMERA_SPEED * camera_right; // Left
-	if((keys_held & (1 << 2))) camera_position -= CAMERA_SPEED * camera_front; // Back
-	if((keys_held & (1 << 3))) camera_position += CAMERA_SPEED * camera_right; // Right
+	// Walk on the xz plane whatever the pitch
+	const glm::vec3& heading = camera.getHeading();
+	const glm::vec3& right = camera.getRight();
+	glm::vec3 offset(0.0f);
+	if((keys_held & (1 << 0))) offset += CAMERA_SPEED * heading; // Forward
+	if((keys_held & (1 << 1))) offset -= CAMERA_SPEED * right; // Left
+	if((keys_held & (1 << 2))) offset -= CAMERA_SPEED * heading; // Back
+	if((keys_held & (1 << 3))) offset += CAMERA_SPEED * right; // Right
+	if(offset == glm::vec3(0.0f)) return;
+
+	// Slide along the scene instead of passing through it
+	std::lock_guard<std::mutex> lock(scene_mutex);
+	camera.setPosition(collision_world.moveSphere(camera.getPosition(), CAMERA_RADIUS, offset));
 }
 
 void handleMouseInput(float xrel, float yrel) {
+	// Accumulate until the next simulation step picks it up
+	std::lock_guard<std::mutex> lock(input_mutex);
+	mouse_xrel += xrel;
+	mouse_yrel += yrel;
+}
 
-	camera_yaw += MOUSE_SENSITIVITY * xrel;
-	camera_pitch -= MOUSE_SENSITIVITY * yrel;
+void updateCameraRotation() {
+	float xrel, yrel;
+	{
+		std::lock_guard<std::mutex> lock(input_mutex);
+		xrel = mouse_xrel;
+		yrel = mouse_yrel;
+		mouse_xrel = 0;
+		mouse_yrel = 0;
+	}
 
-	if(camera_yaw > 360.0f) camera_yaw -= 360.0f;
-	if(camera_yaw < 0.0f) camera_yaw += 360.0f;
+	camera.rotate(MOUSE_SENSITIVITY * xrel, -MOUSE_SENSITIVITY * yrel);
+}
 
-	if(camera_pitch > 90.0f) camera_pitch = 90.0f;
-	if(camera_pitch < -90.0f) camera_pitch = -90.0f;
+void simulateFrame(FrameSnapshot& frame, JobSystem& jobs) {
+	updateCameraRotation();
+	updateCameraPosition();
+
+	frame.camera_position = camera.getPosition();
+	frame.camera_front = camera.getFront();
+	frame.view = camera.getView();
+	frame.projection = camera.getProjection();
+
+	std::lock_guard<std::mutex> lock(scene_mutex);
+
+	// Changed parts of the hierarchy first, then world matrices and bounds
+	// for every entity, one linear sweep per worker
+	scene_graph.update();
+	int count = entities.getCount();
+	jobs.parallelFor(0, count, ENTITY_UPDATE_GRAIN, [](int begin, int end) {
+		entities.updateTransforms(scene_graph, begin, end);
+	});
+
+	// Only entities whose world bounds touch the frustum go into the frame.
+	// The planes are derived before the workers share the camera.
+	camera.getFrustumPlanes();
+	entity_visible.resize(count);
+	const glm::vec3* bounds_min = entities.getWorldBoundsMin();
+	const glm::vec3* bounds_max = entities.getWorldBoundsMax();
+	jobs.parallelFor(0, count, ENTITY_UPDATE_GRAIN, [bounds_min, bounds_max](int begin, int end) {
+		for(int i = begin; i < end; i++)
+			entity_visible[i] = camera.isBoxVisible(bounds_min[i], bounds_max[i]);
+	});
+
+	frame.meshes.clear();
+	frame.materials.clear();
+	frame.models.clear();
+	const MeshHandle* meshes = entities.getMeshes();
+	const uint32_t* materials = entities.getMaterials();
+	const glm::mat4* models = entities.getWorldMatrices();
+	for(int i = 0; i < count; i++) {
+		if(!entity_visible[i]) continue;
+		frame.meshes.push_back(meshes[i]);
+		frame.materials.push_back(materials[i]);
+		frame.models.push_back(models[i]);
+	}
+	frame.material_colors.assign(material_colors.begin(), material_colors.end());
+}
+
+void simulationLoop(FramePipeline* pipeline, JobSystem* jobs) {
+	// Runs ahead of the render thread by at most the pipeline's latency budget
+	while(FrameSnapshot* frame = pipeline->beginWrite()) {
+		simulateFrame(*frame, *jobs);
+		pipeline->publish();
+	}
+}
 
+void buildSortKeys(std::vector<SortItem>& items, const FrameSnapshot& frame, int begin, int end,
+				   const SceneProgram programs[2]) {
+	for(int i = begin; i < end; i++) {
+		// Prisms removed after the snapshot was taken keep a key but record nothing
+		// The page and format select the vertex array, or the pulled buffers.
+		// Materials are looked up per draw, so they do not split batches.
+		const MeshRange& range = mesh_pool.getRange(frame.meshes[i]);
+		uint32_t vertexArray = range.page < 0 ? 0 : range.page * 2 + range.format + 1;
+		GLuint shaderProgram = programs[range.page < 0 ? VERTEX_FORMAT_FLOAT3 : range.format].program;
+
+		// Front to back by distance of the model origin, normalized by the far plane
+		glm::vec3 origin = glm::vec3(frame.models[i][3]);
+		float depth = glm::length(origin - frame.camera_position) / 100.0f;
+
+		items[i].key = makeSortKey(0, shaderProgram, 0, vertexArray, depth);
+		items[i].index = i;
+	}
 }
 
-int main() {
+void recordPrismDraws(CommandList& list, const FrameSnapshot& frame, const std::vector<SortItem>& items,
+					  int begin, int end, const SceneProgram programs[2]) {
+	// Sorted by program, so quantized meshes switch programs once per list
+	list.clear();
+	GLuint program = 0;
+	for(int item = begin; item < end; item++) {
+		int i = items[item].index;
+		const MeshRange& range = mesh_pool.getRange(frame.meshes[i]);
+		if(range.page < 0) continue;
+
+		const SceneProgram& scene = programs[range.format];
+		if(scene.program != program) {
+			list.bindProgram(scene.program);
+			program = scene.program;
+		}
+		list.bindVertexArray(mesh_pool.getVertexArray(range.page, range.format));
+		if(range.format == VERTEX_FORMAT_UNORM16X3) {
+			list.setVector(scene.position_scale, range.position_scale);
+			list.setVector(scene.position_offset, range.position_offset);
+		}
+		list.setMatrix(scene.model, glm::value_ptr(frame.models[i]));
+		list.drawIndexed(range.index_count, range.first_index, range.base_vertex);
+	}
+}
 
-	SDL_Window* window;
-	SDL_GLContext glContext;
-	init(&window, &glContext);
+GLsizeiptr getDrawTablesSize(const FrameSnapshot& frame, GLsizeiptr alignment) {
+	// Sized for the larger command layout, plus padding to align each table
+	GLsizeiptr perDraw = sizeof(DrawRecord) + sizeof(glm::mat4) + sizeof(DrawElementsIndirectCommand);
+	return (GLsizeiptr)frame.meshes.size() * perDraw + frame.material_colors.size() * sizeof(glm::vec4) + 4 * alignment;
+}
 
-	GLuint shaderProgram = initializeShaders();
+void fillDrawTables(std::vector<DrawRun>& runs, const DrawTables& tables, const FrameSnapshot& frame,
+					const std::vector<SortItem>& items, int begin, int end) {
+	// Slots are the sorted positions, each command passes its own as gl_BaseInstance
+	runs.clear();
+	for(int item = begin; item < end; item++) {
+		int i = items[item].index;
+		const MeshRange& range = mesh_pool.getRange(frame.meshes[i]);
+		if(range.page < 0) continue;
+
+		DrawRecord& record = tables.records[item];
+		record.material = frame.materials[i];
+		record.first_index = range.first_index;
+		record.first_word = range.first_word;
+		record.format = range.format;
+		for(int axis = 0; axis < 3; axis++) {
+			record.position_scale[axis] = range.position_scale[axis];
+			record.position_offset[axis] = range.position_offset[axis];
+		}
+		record.position_scale[3] = 0.0f;
+		record.position_offset[3] = 0.0f;
+		tables.transforms[item] = frame.models[i];
+
+		if(tables.pulling) {
+			DrawArraysIndirectCommand command = { (GLuint)range.index_count, 1, 0, (GLuint)item };
+			memcpy(tables.commands + item * sizeof(command), &command, sizeof(command));
+		} else {
+			DrawElementsIndirectCommand command = { (GLuint)range.index_count, 1, range.first_index,
+													range.base_vertex, (GLuint)item };
+			memcpy(tables.commands + item * sizeof(command), &command, sizeof(command));
+		}
+
+		// Pulled draws only need the same page, vertex arrays also the same format
+		bool extends = !runs.empty() && runs.back().end == item && runs.back().page == range.page &&
+					   (tables.pulling || runs.back().format == range.format);
+		if(extends) {
+			runs.back().end++;
+			runs.back().triangles += range.index_count / 3;
+		} else {
+			DrawRun run = { range.page, range.format, item, item + 1, range.index_count / 3 };
+			runs.push_back(run);
+		}
+	}
+}
+
+void recordTableDraws(CommandList& list, const std::vector<std::vector<DrawRun>>& chunkRuns, int chunkCount,
+					  const DrawTables& tables, GLuint shaderProgram, GLuint indirectBuffer) {
+	// Runs continue across chunk boundaries, merged here into one multi-draw each
+	GLsizeiptr stride = tables.pulling ? sizeof(DrawArraysIndirectCommand) : sizeof(DrawElementsIndirectCommand);
+	list.clear();
+	list.bindProgram(shaderProgram);
+
+	DrawRun batch = { -1, VERTEX_FORMAT_FLOAT3, 0, 0, 0 };
+	for(int chunk = 0; chunk <= chunkCount; chunk++) {
+		const std::vector<DrawRun>* runs = chunk < chunkCount ? &chunkRuns[chunk] : nullptr;
+		size_t runCount = runs ? runs->size() : 1;
+		for(size_t r = 0; r < runCount; r++) {
+			if(runs) {
+				const DrawRun& run = (*runs)[r];
+				bool extends = batch.page == run.page && batch.end == run.begin &&
+							   (tables.pulling || batch.format == run.format);
+				if(extends) {
+					batch.end = run.end;
+					batch.triangles += run.triangles;
+					continue;
+				}
+			}
+
+			if(batch.page >= 0) {
+				if(tables.pulling) {
+					list.bindStorage(0, mesh_pool.getVertexBuffer(batch.page));
+					list.bindStorage(1, mesh_pool.getIndexBuffer(batch.page));
+				} else {
+					list.bindVertexArray(mesh_pool.getVertexArray(batch.page, batch.format));
+				}
+				list.multiDrawIndirect(indirectBuffer, !tables.pulling, tables.commands_offset + batch.begin * stride,
+									   batch.end - batch.begin, batch.triangles);
+			}
+			if(runs) batch = (*runs)[r];
+		}
+	}
+}
+
+bool hasExtension(const std::string& path, const char* extension) {
+	size_t length = strlen(extension);
+	return path.size() >= length && path.compare(path.size() - length, length, extension) == 0;
+}
+
+bool loadGltf(const std::string& path, GltfFile& gltfFile, AssetStreamer& streamer) {
+	typedef std::chrono::steady_clock Clock;
+	Clock::time_point start = Clock::now();
+	if(!gltfFile.open(path)) return false;
+
+	// Nodes join the scene graph parents first, placements hang below them
+	uint32_t firstMaterial;
+	const std::vector<GltfNode>& nodes = gltfFile.getNodes();
+	std::vector<SceneNode> graphNodes(nodes.size());
+	{
+		std::lock_guard<std::mutex> lock(scene_mutex);
+		firstMaterial = material_colors.size();
+		const std::vector<glm::vec4>& colors = gltfFile.getMaterialColors();
+		material_colors.insert(material_colors.end(), colors.begin(), colors.end());
+		for(size_t i = 0; i < nodes.size(); i++) {
+			graphNodes[i] = scene_graph.create(nodes[i].parent < 0 ? INVALID_SCENE_NODE : graphNodes[nodes[i].parent]);
+			scene_graph.setLocalTransform(graphNodes[i], nodes[i].transform);
+		}
+	}
 
+	// Each primitive is uploaded once and drawn at all of its placements
+	const std::vector<GltfInstance>& instances = gltfFile.getInstances();
+	std::vector<std::vector<StreamedPlacement>> placements(gltfFile.getPrimitiveCount());
+	for(size_t i = 0; i < instances.size(); i++) {
+		int material = gltfFile.getPrimitiveMaterial(instances[i].primitive);
+		StreamedPlacement placement = { material < 0 ? 0 : firstMaterial + material, instances[i].transform,
+										graphNodes[instances[i].node] };
+		placements[instances[i].primitive].push_back(placement);
+	}
+	for(int i = 0; i < gltfFile.getPrimitiveCount(); i++) {
+		StreamedMesh mesh = { gltfFile.getPrism(i), placements[i], 0 };
+		mesh.collision = std::make_shared<CollisionShape>(mesh.prism, COLLISION_CELL_SIZE);
+		streamer.submit(mesh);
+	}
 
-	// Create prism
-	int vertexCount = sizeof(cubeVertices) / sizeof(float);
-	int indexCount = sizeof(cubeIndices) / sizeof(unsigned int);
-	Prism prism(cubeVertices, vertexCount, cubeIndices, indexCount);
-	prism_array.push_back(prism);
+	double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	double mb = gltfFile.getSize() / (1024.0 * 1024.0);
+	printf("Loaded %s, %d primitives (%d copied), %zu instances, %.1f MB in %.1f ms (%.1f ms/MB)\n", path.c_str(),
+		   gltfFile.getPrimitiveCount(), gltfFile.getCopiedCount(), instances.size(), mb, ms, mb > 0.0 ? ms / mb : 0.0);
+	return true;
+}
 
+bool loadModel(const std::string& path, JobSystem& jobs, SceneFile& sceneFile, GltfFile& gltfFile,
+			   AssetStreamer& streamer) {
+	// Runs on the streamer's thread, meshes are uploaded over the next frames
+	typedef std::chrono::steady_clock Clock;
+	Clock::time_point start = Clock::now();
+
+	// glTF buffers are mapped and viewed like scene files
+	if(hasExtension(path, ".gltf") || hasExtension(path, ".glb")) return loadGltf(path, gltfFile, streamer);
+
+	// Scene files are uploaded straight from the mapping, which has to stay open
+	if(hasExtension(path, ".d3s")) {
+		if(!sceneFile.open(path)) return false;
+		for(int i = 0; i < sceneFile.getMeshCount(); i++)
+			submitPrism(streamer, sceneFile.getPrism(i));
+		double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		printf("Loaded %s, %d meshes, %.1f MB in %.1f ms\n", path.c_str(), sceneFile.getMeshCount(),
+			   sceneFile.getSize() / (1024.0 * 1024.0), ms);
+		return true;
+	}
 
-	// Build vertex buffer
-	GLuint VAO, VBO, EBO;
-	initializeVertexBuffer(&VAO, &VBO, &EBO);
+	// Imported models upload 16 bit positions, two words per vertex instead of three
+	ImportedMesh model;
+	MeshImporter importer(jobs);
+	if(!importer.load(path, model)) return false;
+	submitPrism(streamer, Prism(std::move(model.vertices), std::move(model.indices)), VERTEX_FORMAT_UNORM16X3);
+	return true;
+}
 
+int convertModels(int count, char* paths[], const char* output) {
+	// No window needed, models are imported and written as one scene file
+	JobSystem jobs(-1);
+	MeshImporter importer(jobs);
+	std::vector<ImportedMesh> meshes(count);
+	for(int i = 0; i < count; i++)
+		if(!importer.load(paths[i], meshes[i])) return 1;
+
+	if(!writeSceneFile(output, meshes)) return 1;
+	printf("Wrote %s, %d meshes\n", output, count);
+	return 0;
+}
 
+void runStartupBenchmark() {
+	typedef std::chrono::steady_clock Clock;
+
+	shader_manager.setCacheEnabled(false);
+	Clock::time_point start = Clock::now();
+	shader_manager.get(initializeShaders(SHADER_LIGHTING));
+	glFinish();
+	double sourceMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	shader_manager.destroy();
+
+	// Make sure an entry exists, then time the cached path on its own
+	shader_manager.setCacheEnabled(true);
+	shader_manager.get(initializeShaders(SHADER_LIGHTING));
+	shader_manager.destroy();
+	start = Clock::now();
+	shader_manager.get(initializeShaders(SHADER_LIGHTING));
+	glFinish();
+	double cachedMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	shader_manager.destroy();
+
+	printf("Shader startup\n");
+	printf("  from source:       %8.3f ms\n", sourceMs);
+	printf("  from binary cache: %8.3f ms (%d hits, %d misses)\n", cachedMs,
+		   program_cache.getHitCount(), program_cache.getMissCount());
+}
+
+double timeSceneDraws(const SceneProgram& scene, GLenum polygonMode, const MeshRange& range, GLuint query) {
+	glm::mat4 model = glm::mat4(1.0f);
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, -2.5f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+
+	gl_state.useProgram(scene.program);
+	glUniformMatrix4fv(scene.model, 1, GL_FALSE, glm::value_ptr(model));
+	glUniformMatrix4fv(scene.view, 1, GL_FALSE, glm::value_ptr(view));
+	glUniformMatrix4fv(scene.projection, 1, GL_FALSE, glm::value_ptr(projection));
+	gl_state.bindVertexArray(mesh_pool.getVertexArray(range.page, range.format));
+	gl_state.polygonMode(polygonMode);
+	gl_state.setDepthTest(true);
+	gl_state.depthMask(true);
+
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	glBeginQuery(GL_TIME_ELAPSED, query);
+	for(int i = 0; i < WIREFRAME_BENCHMARK_DRAWS; i++) {
+		glDrawElementsBaseVertex(GL_TRIANGLES, range.index_count, GL_UNSIGNED_INT,
+								 (void*)(range.first_index * sizeof(unsigned int)), range.base_vertex);
+	}
+	glEndQuery(GL_TIME_ELAPSED);
+
+	// Blocks until the GPU is done, fine outside the frame loop
+	GLuint64 elapsed = 0;
+	glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+	return (double)elapsed / 1000000.0 / WIREFRAME_BENCHMARK_DRAWS;
+}
+
+void runWireframeBenchmark() {
+	// Screen filling grid, two triangles per cell
+	int grid = WIREFRAME_BENCHMARK_GRID;
+	std::vector<float> vertices;
+	std::vector<unsigned int> indices;
+	for(int y = 0; y <= grid; y++) {
+		for(int x = 0; x <= grid; x++) {
+			vertices.push_back((float)x / grid * 2.0f - 1.0f);
+			vertices.push_back((float)y / grid * 2.0f - 1.0f);
+			vertices.push_back(0.0f);
+		}
+	}
+	for(int y = 0; y < grid; y++) {
+		for(int x = 0; x < grid; x++) {
+			unsigned int corner = y * (grid + 1) + x;
+			unsigned int quad[6] = { corner, corner + 1, corner + grid + 2, corner + grid + 2, corner + grid + 1, corner };
+			indices.insert(indices.end(), quad, quad + 6);
+		}
+	}
+
+	Prism prism(vertices.data(), vertices.size(), indices.data(), indices.size());
+	MeshHandle mesh = mesh_pool.add(prism);
+	const MeshRange& range = mesh_pool.getRange(mesh);
+
+	GLuint query;
+	glGenQueries(1, &query);
+
+	// Same lit program drawn with glPolygonMode lines, so only the edge overlay differs
+	SceneProgram polygonScene = getSceneProgram(SHADER_LIGHTING);
+	SceneProgram shaderScene = getSceneProgram(SHADER_LIGHTING | SHADER_WIREFRAME);
+
+	// The first draw of each path absorbs any driver warm up
+	timeSceneDraws(polygonScene, GL_LINE, range, query);
+	double polygonMs = timeSceneDraws(polygonScene, GL_LINE, range, query);
+	timeSceneDraws(shaderScene, GL_FILL, range, query);
+	double shaderMs = timeSceneDraws(shaderScene, GL_FILL, range, query);
+
+	printf("Wireframe, %d triangles per draw\n", range.index_count / 3);
+	printf("  glPolygonMode lines:        %8.3f ms\n", polygonMs);
+	printf("  barycentric edge overlay:   %8.3f ms\n", shaderMs);
+
+	glDeleteQueries(1, &query);
+	mesh_pool.remove(mesh);
+}
+
+int main(int argc, char* argv[]) {
+
+	// ./d3 [model], ./d3 --world, ./d3 --benchmark [model] or ./d3 --convert output.d3s models...
+	if(argc > 3 && std::string(argv[1]) == "--convert") return convertModels(argc - 3, argv + 3, argv[2]);
+
+	bool benchmark = argc > 1 && std::string(argv[1]) == "--benchmark";
+	const char* modelPath = argc > (benchmark ? 2 : 1) ? argv[benchmark ? 2 : 1] : nullptr;
+	bool world = !benchmark && modelPath && std::string(modelPath) == "--world";
+	if(world) modelPath = nullptr;
+	if(benchmark) runBenchmarks(modelPath);
+
+	SDL_Window* window;
+	SDL_GLContext glContext;
+	init(&window, &glContext);
+
+	initializeShaderManager();
+	if(benchmark) {
+		runStartupBenchmark();
+		runWireframeBenchmark();
+		mesh_pool.destroy();
+		shader_manager.destroy();
+		SDL_GL_DestroyContext(glContext);
+		SDL_DestroyWindow(window);
+		SDL_Quit();
+		return 0;
+	}
+
+	// Start every shader compile before loading anything else, only the
+	// permutations this scene can draw with are built
+	draw_tables_enabled = GLAD_GL_VERSION_4_6;
+	vertex_pulling_enabled = draw_tables_enabled;
+	for(int pulling = 0; pulling <= (int)vertex_pulling_enabled; pulling++) {
+		initializeShaders(getSceneFeatures(true, pulling));
+		initializeShaders(getSceneFeatures(false, pulling));
+	}
+	if(!draw_tables_enabled) {
+		initializeShaders(getSceneFeatures(true, false) | SHADER_QUANTIZED_POSITIONS);
+		initializeShaders(getSceneFeatures(false, false) | SHADER_QUANTIZED_POSITIONS);
+	}
+
+	// Per-frame streaming buffers, draw tables in their own so it can grow
+	RingBuffer frameData(FRAME_DATA_SIZE);
+	frameData.initialize();
+	RingBuffer drawData(DRAW_DATA_SIZE);
+	drawData.initialize();
+
+	// Performance overlay
+	hud.initialize(frameData, shader_manager);
+	GpuTimer gpuTimer;
+	gpuTimer.initialize();
+
+	// Worker threads for per-frame CPU work and loading
+	JobSystem jobs(-1);
+
+	// Create prism, from the model or scene file if one was given. Loading
+	// runs in the background and the first frame does not wait for it.
+	SceneFile sceneFile;
+	GltfFile gltfFile(jobs);
+	AssetStreamer streamer(mesh_pool, UPLOAD_BUDGET);
+	streamer.initialize();
+	std::string model = modelPath ? modelPath : "";
+	streamer.request([&]() {
+		if(model.empty() || !loadModel(model, jobs, sceneFile, gltfFile, streamer)) {
+			int vertexCount = sizeof(cubeVertices) / sizeof(float);
+			int indexCount = sizeof(cubeIndices) / sizeof(unsigned int);
+			submitPrism(streamer, Prism(cubeVertices, vertexCount, cubeIndices, indexCount));
+		}
+	});
+
+	// Terrain chunks streamed around the camera, within a fixed memory budget
+	std::unique_ptr<WorldPartition> worldPartition;
+	std::vector<uint32_t> evictedChunks;
+	if(world) {
+		worldPartition.reset(new WorldPartition(streamer, generateTerrainChunk, WORLD_CHUNK_SIZE, WORLD_LOAD_RADIUS,
+												WORLD_PREFETCH_DISTANCE, WORLD_MEMORY_CAP));
+	}
+	Uint64 streamStart = SDL_GetPerformanceCounter();
+	bool streaming = true;
+
+	int screenWidth = 800, screenHeight = 600;
+	SDL_GetWindowSizeInPixels(window, &screenWidth, &screenHeight);
+	Uint64 frameStart = SDL_GetPerformanceCounter();
+	FrameStats stats = {};
+
+	// First use of the scene program
+	bool sceneWireframe = wireframe_enabled;
+	bool scenePulling = vertex_pulling_enabled;
+	SceneProgram scenes[2];
+	getScenePrograms(sceneWireframe, scenePulling, scenes);
+	const SceneProgram& scene = scenes[VERTEX_FORMAT_FLOAT3];
+
+	// Vertex pulling fetches everything in the shader, but core profile
+	// still needs some vertex array bound to draw
+	std::vector<std::vector<DrawRun>> chunkRuns;
+	CommandList tableDraws;
+	GLuint emptyVertexArray;
+	glGenVertexArrays(1, &emptyVertexArray);
+	GLint storageAlignment = 16;
+	if(GLAD_GL_VERSION_4_3) glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+
+	// Draw recording, one list per chunk of prisms plus one for frame setup
+	CommandList frameSetup;
+	std::vector<CommandList> commandLists;
+	CommandReplayer replayer;
+	std::vector<SortItem> sortItems;
+	std::vector<SortItem> sortScratch;
+
+	// Simulation runs on its own thread, one frame ahead of submission
+	FramePipeline pipeline(PIPELINE_LATENCY);
+	std::thread simulation(simulationLoop, &pipeline, &jobs);
 
     // Main loop
     bool running = true;
@@ -286,62 +1123,177 @@ int main() {
 				running = handleKeyboardInput(event);
 			}
 		}
-		updateCameraPosition();
 
+		// Pick up programs the driver finished compiling
+		shader_manager.poll();
+
+		// Submit the oldest snapshot the simulation has published
+		const FrameSnapshot* frame = pipeline.acquire();
+
+		frameData.beginFrame();
+
+		// Draw tables need a slot per visible draw, the ring grows to hold
+		// them all instead of dropping the scene
+		GLsizeiptr drawDataSize = getDrawTablesSize(*frame, storageAlignment);
+		if(draw_tables_enabled && drawDataSize > drawData.getFrameSize())
+			drawData.resize(std::max(drawDataSize, drawData.getFrameSize() * 2));
+		drawData.beginFrame();
+		gpuTimer.begin();
+
+		// Upload what the loader has decoded so far, up to the frame's budget.
+		// Finished meshes join the scene with the next snapshot.
+		if(worldPartition) {
+			worldPartition->update(frame->camera_position, frame->camera_front, evictedChunks);
+			for(size_t i = 0; i < evictedChunks.size(); i++) {
+				streamer.cancel(evictedChunks[i]);
+				removeChunk(evictedChunks[i]);
+			}
+		}
+		streamer.update([&](MeshHandle mesh, StreamedMesh& streamed) {
+			// Chunks evicted while their meshes were uploading drop them here
+			if(worldPartition && !worldPartition->accept(streamed.group)) {
+				mesh_pool.remove(mesh);
+				return;
+			}
+			if(worldPartition) placeInChunk(streamed, *worldPartition);
+			addStreamedMesh(mesh, streamed);
+		});
+		if(streaming && streamer.getPendingCount() == 0) {
+			float ms = (float)(SDL_GetPerformanceCounter() - streamStart) * 1000.0f / (float)SDL_GetPerformanceFrequency();
+			printf("Streaming finished after %.1f ms\n", ms);
+			streaming = false;
+		}
 
         // Clear the screen
-        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
-
-        glUseProgram(shaderProgram);
-		if(WIREFRAME_ENABLED) glPolygonMode(GL_FRONT_AND_BACK, GL_LINE); // Enable wireframe
-
-		// Get time
-		float timeSeconds = (float)SDL_GetTicks() / 1000.0f;
-
-		// Build vertex matrices
-		glm::mat4 model = glm::mat4(1.0f);
-        model = glm::rotate(model, 0.0f, glm::vec3(0.0f, 1.0f, 1.0f)); // Rotate model
-        model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f)); // Scale model
-
-		// Rotate camera
-		float pitchAngle = glm::radians(PI/2);
-		float cosYaw = cos(pitchAngle);
-		float sinYaw = sin(pitchAngle);
-
-		glm::vec3 camera_front = getCameraFront();
-	
-		glm::mat4 view = glm::lookAt(camera_position, camera_position + camera_front, glm::vec3(0.0f, 1.0f, 0.0f));
-
-        glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
-
-		// Pass matrices to shader
-		GLint modelLoc = glGetUniformLocation(shaderProgram, "uModel");
-        GLint viewLoc = glGetUniformLocation(shaderProgram, "uView");
-        GLint projLoc = glGetUniformLocation(shaderProgram, "uProjection");
+        gl_state.clearColor(0.1f, 0.1f, 0.1f, 1.0f);
+        gl_state.setDepthTest(true);
+        gl_state.depthMask(true);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+		// Wireframe is an edge overlay in the shader, switch variants when toggled
+		if(sceneWireframe != wireframe_enabled || scenePulling != vertex_pulling_enabled) {
+			sceneWireframe = wireframe_enabled;
+			scenePulling = vertex_pulling_enabled;
+			getScenePrograms(sceneWireframe, scenePulling, scenes);
+		}
 
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-        glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-        glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
+		// Sort draws by state, then record them on the workers in sorted order.
+		// Mesh pool ranges are stable until defragment().
+		sortItems.resize(frame->meshes.size());
+		jobs.parallelFor(0, frame->meshes.size(), COMMAND_CHUNK_SIZE, [&](int begin, int end) {
+			buildSortKeys(sortItems, *frame, begin, end, scenes);
+		});
+		radixSort(sortItems, sortScratch);
+
+		int chunkCount = (frame->meshes.size() + COMMAND_CHUNK_SIZE - 1) / COMMAND_CHUNK_SIZE;
+		if((int)commandLists.size() < chunkCount) commandLists.resize(chunkCount);
+		if((int)chunkRuns.size() < chunkCount) chunkRuns.resize(chunkCount);
+
+		frameSetup.clear();
+		const SceneProgram& quantizedScene = scenes[VERTEX_FORMAT_UNORM16X3];
+		if(quantizedScene.program != scene.program) {
+			frameSetup.bindProgram(quantizedScene.program);
+			frameSetup.setMatrix(quantizedScene.view, glm::value_ptr(frame->view));
+			frameSetup.setMatrix(quantizedScene.projection, glm::value_ptr(frame->projection));
+		}
+		frameSetup.bindProgram(scene.program);
+		frameSetup.setMatrix(scene.view, glm::value_ptr(frame->view));
+		frameSetup.setMatrix(scene.projection, glm::value_ptr(frame->projection));
+		tableDraws.clear();
+
+		int drawCount = frame->meshes.size();
+		int legacyChunks = 0;
+		if(draw_tables_enabled && drawCount > 0) {
+			// Per-draw data goes to tables in this frame's draw data region
+			GLsizeiptr commandSize = scenePulling ? sizeof(DrawArraysIndirectCommand) : sizeof(DrawElementsIndirectCommand);
+			GLsizeiptr recordsSize = drawCount * sizeof(DrawRecord);
+			GLsizeiptr transformsSize = drawCount * sizeof(glm::mat4);
+			GLsizeiptr materialsSize = frame->material_colors.size() * sizeof(glm::vec4);
+			RingAllocation records = drawData.allocate(recordsSize, storageAlignment);
+			RingAllocation transforms = drawData.allocate(transformsSize, storageAlignment);
+			RingAllocation materials = drawData.allocate(materialsSize, storageAlignment);
+			RingAllocation commands = drawData.allocate(drawCount * commandSize, sizeof(GLuint));
+
+			if(records.data && transforms.data && materials.data && commands.data) {
+				DrawTables tables = { (DrawRecord*)records.data, (glm::mat4*)transforms.data,
+									  (uint8_t*)commands.data, commands.offset, scenePulling };
+				memcpy(materials.data, frame->material_colors.data(), materialsSize);
+				jobs.parallelFor(0, drawCount, COMMAND_CHUNK_SIZE, [&](int begin, int end) {
+					fillDrawTables(chunkRuns[begin / COMMAND_CHUNK_SIZE], tables, *frame, sortItems, begin, end);
+				});
+				drawData.flush();
+
+				GLuint buffer = drawData.getBuffer();
+				frameSetup.bindStorage(2, buffer, records.offset, recordsSize);
+				frameSetup.bindStorage(3, buffer, transforms.offset, transformsSize);
+				frameSetup.bindStorage(4, buffer, materials.offset, materialsSize);
+				if(scenePulling) frameSetup.bindVertexArray(emptyVertexArray);
+				recordTableDraws(tableDraws, chunkRuns, chunkCount, tables, scene.program, buffer);
+			}
+		} else if(!draw_tables_enabled) {
+			// One uniform update and draw per prism
+			jobs.parallelFor(0, drawCount, COMMAND_CHUNK_SIZE, [&](int begin, int end) {
+				recordPrismDraws(commandLists[begin / COMMAND_CHUNK_SIZE], *frame, sortItems, begin, end, scenes);
+			});
+			legacyChunks = chunkCount;
+		}
 
         // Draw triangles
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+		GL_DEBUG_MARK();
+		replayer.beginFrame();
+		replayer.replay(frameSetup);
+		replayer.replay(tableDraws);
+		for(int i = 0; i < legacyChunks; i++)
+			replayer.replay(commandLists[i]);
+
+		gpuTimer.end();
+
+		// Compact freed mesh pool space a little every frame
+		mesh_pool.defragment(DEFRAG_BUDGET);
+
+		// Draw performance overlay
+		stats.gpu_ms = gpuTimer.getMilliseconds();
+		stats.draw_calls = replayer.getDrawCount();
+		stats.visible_prisms = frame->meshes.size();
+		stats.triangles = replayer.getTriangleCount();
+		stats.streaming_pending = streamer.getPendingCount();
+		stats.uploaded_bytes = streamer.getUploadedBytes();
+		hud.draw(stats, screenWidth, screenHeight, frameData);
+		frameData.endFrame();
+		drawData.endFrame();
+		pipeline.release();
+		mesh_pool.endFrame();
+
+		// State counters cover the whole frame, shown on the next one
+		stats.program_binds = gl_state.getProgramBindCount();
+		stats.vertex_array_binds = gl_state.getVertexArrayBindCount();
+		stats.gl_calls_issued = gl_state.getIssuedCount();
+		stats.gl_calls_suppressed = gl_state.getSuppressedCount();
+		gl_state.resetCounters();
 
         // Swap buffers
         SDL_GL_SwapWindow(window);
 
-        // Check for OpenGL errors
-        GLenum err;
-        while ((err = glGetError()) != GL_NO_ERROR) {
-            std::cerr << "OpenGL error: " << err << std::endl;
-        }
+		// Measure frame time including the swap
+		Uint64 frameEnd = SDL_GetPerformanceCounter();
+		stats.frame_ms = (float)(frameEnd - frameStart) * 1000.0f / (float)SDL_GetPerformanceFrequency();
+		frameStart = frameEnd;
     }
 
     // Cleanup
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
-    glDeleteProgram(shaderProgram);
+	streamer.destroy();
+	pipeline.stop();
+	simulation.join();
+	gl_state.forgetVertexArray(emptyVertexArray);
+	glDeleteVertexArrays(1, &emptyVertexArray);
+	gpuTimer.destroy();
+	hud.destroy();
+	frameData.destroy();
+	drawData.destroy();
+	mesh_pool.destroy();
+	shader_manager.destroy();
+	sceneFile.close();
+	gltfFile.close();
 
     // Cleanup SDL
 	SDL_CaptureMouse(false);